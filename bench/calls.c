@@ -0,0 +1,74 @@
+/* call-overhead micro-benchmark. compare the stack and register 
+   calling conventions with, e.g.:
+
+        ncc -O -c bench/calls.c
+        nld -b 0x10000000 -e _main -o calls bench/calls.o
+        time nexec -b 0x10000000 calls
+
+   and the same with ncc -O -r. (with -r, the library must be compiled
+   with -r too, but this doesn't use it.) nexec prints the exit code,
+   i.e., main()'s return value, which is a checksum. */
+
+#define ITERATIONS  10000000
+
+static int
+add2(int a, int b)
+{
+    return a + b;
+}
+
+static long
+add6(long a, long b, long c, long d, long e, long f)
+{
+    return a + b + c + d + e + f;
+}
+
+static double
+scale(double x, double y, float z)
+{
+    return x * y + z;
+}
+
+static int
+mixed(char * p, int i, double d)
+{
+    return p[i & 7] + (d > 1.5);
+}
+
+static int * alias;
+
+static int
+aliased(int a)      /* 'a' must be read after the store */
+{
+    return (*alias = 1) + a;
+}
+
+static int
+fib(int n)
+{
+    return (n < 2) ? n : fib(n - 1) + fib(n - 2);
+}
+
+int
+main(void)
+{
+    static char buf[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    long        sum = 0;
+    double      acc = 0;
+    int         i;
+    int         x;
+
+    alias = &x;
+
+    for (i = 0; i < ITERATIONS; ++i) {
+        sum += add2(i, 1);
+        sum += add6(i, 1, 2, 3, 4, sum & 15);
+        acc = scale(acc, 0.5, 1.0f);
+        sum += mixed(buf, i, acc);
+        x = i & 3;
+        sum += aliased(x) * 10 + x;
+    }
+
+    sum += fib(27);
+    return (int) ((sum + (acc > 1.5)) % 1000003);
+}
@@ -0,0 +1,87 @@
+/* division, modulo and multiplication by constants: the sort of thing
+   hashing, bucket indexing and radix conversion are made of. compare
+   with the output of an older compiler, e.g.:
+
+        ncc -O -c bench/divmod.c
+        nld -b 0x10000000 -e _main -o divmod bench/divmod.o
+        time nexec -b 0x10000000 divmod
+
+   the exit code nexec prints is a checksum. */
+
+#define N           4096
+#define PASSES      400
+#define BUCKETS     1021
+
+static unsigned      keys[N];
+static long          values[N];
+static int           buckets[BUCKETS];
+
+/* the multiplicative string hash, reduced modulo a prime table size */
+
+static unsigned
+bucket(unsigned key)
+{
+    unsigned h = key;
+
+    h = h * 31 + (key >> 8);
+    h = h * 33 + (key >> 16);
+    return h % BUCKETS;
+}
+
+/* decimal digit sum, as in number-to-string conversion */
+
+static int
+digits(long v)
+{
+    int s = 0;
+
+    if (v < 0) v = -v;
+
+    while (v) {
+        s += v % 10;
+        v /= 10;
+    }
+
+    return s;
+}
+
+/* signed division by assorted constants, and small multiplies */
+
+static long
+scale(long v)
+{
+    return v / 3 + v / 7 - v / -12 + (v % 1000) * 5 + (v / 100) * 9 + v * 6;
+}
+
+static int
+mix(int x)
+{
+    return x / 5 + x % 9 + x * 3 + (x / 641) * 10;
+}
+
+int
+main(void)
+{
+    unsigned seed = 12345;
+    long     s = 0;
+    int      i;
+    int      j;
+
+    for (i = 0; i < N; i++) {
+        seed = seed * 1103515245 + 12345;
+        keys[i] = seed;
+        values[i] = (long) seed * ((i & 1) ? 1 : -1);
+    }
+
+    for (j = 0; j < PASSES; j++) {
+        for (i = 0; i < N; i++) {
+            buckets[bucket(keys[i] + j)]++;
+            s += digits(values[i]) + scale(values[i]) + mix((int) values[i] + j);
+        }
+    }
+
+    for (i = 0; i < BUCKETS; i++)
+        s += buckets[i] * i;
+
+    return (int) (s % 1000003);
+}
@@ -0,0 +1,110 @@
+/* memory-streaming micro-benchmark: the usual copy, scale, add and triad 
+   kernels, plus reductions, over arrays too big for the L1 cache. e.g.:
+
+        ncc -O -c bench/stream.c
+        nld -b 0x10000000 -e _main -o stream bench/stream.o
+        time nexec -b 0x10000000 stream
+
+   the exit code nexec prints is a checksum. */
+
+#define N           20000
+#define PASSES      200
+
+static double a[N], b[N], c[N];
+static int    x[N], y[N];
+
+static void
+copy(double * dst, double * src, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) 
+        dst[i] = src[i];
+}
+
+static void
+scale(double * dst, double * src, double k, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) 
+        dst[i] = k * src[i];
+}
+
+static void
+add(double * dst, double * src1, double * src2, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) 
+        dst[i] = src1[i] + src2[i];
+}
+
+static void
+triad(double * dst, double * src1, double * src2, double k, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) 
+        dst[i] = src1[i] + k * src2[i];
+}
+
+static long
+sum(int * v, int n)
+{
+    long s = 0;
+    int  i;
+
+    for (i = 0; i < n; i++) 
+        s += v[i];
+
+    return s;
+}
+
+/* the index is negated and complemented, as in reversed traversals */
+
+static long
+weigh(int * v, long n)
+{
+    long s = 0;
+    long i;
+
+    for (i = 0; i < n; i++) 
+        s += v[i] * -i + ~i;
+
+    return s;
+}
+
+static void
+iadd(int * dst, int * src, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) 
+        dst[i] += src[i];
+}
+
+int
+main(void)
+{
+    long s = 0;
+    int  i;
+
+    for (i = 0; i < N; i++) {
+        a[i] = i;
+        x[i] = i & 255;
+        y[i] = 1;
+    }
+
+    for (i = 0; i < PASSES; i++) {
+        copy(b, a, N);
+        scale(c, b, 0.5, N);
+        add(a, b, c, N);
+        triad(b, a, c, 0.25, N);
+        iadd(x, y, N);
+        s += sum(x, N);
+        s += weigh(x, N);
+    }
+
+    return (int) ((s + (long) b[N - 1]) % 1000003);
+}
@@ -514,6 +514,112 @@ struct insn insns[] =
     { "setnle", 1, { O_MRM_8 | O_I_MODRM }, 3, { 0x0F, 0x9F, 0x00 }, 0 },
     { "setg", 1, { O_MRM_8 | O_I_MODRM }, 3, { 0x0F, 0x9F, 0x00 }, 0 },
 
+    { "cmovo", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x40, 0x00 }, I_DATA_16 },
+    { "cmovo", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x40, 0x00 }, I_DATA_32 },
+    { "cmovo", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x40, 0x00 }, I_DATA_64 },
+
+    { "cmovno", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x41, 0x00 }, I_DATA_16 },
+    { "cmovno", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x41, 0x00 }, I_DATA_32 },
+    { "cmovno", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x41, 0x00 }, I_DATA_64 },
+
+    { "cmovb", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_16 },
+    { "cmovb", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_32 },
+    { "cmovb", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_64 },
+    { "cmovc", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_16 },
+    { "cmovc", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_32 },
+    { "cmovc", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_64 },
+    { "cmovnae", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_16 },
+    { "cmovnae", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_32 },
+    { "cmovnae", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x42, 0x00 }, I_DATA_64 },
+
+    { "cmovnb", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_16 },
+    { "cmovnb", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_32 },
+    { "cmovnb", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_64 },
+    { "cmovnc", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_16 },
+    { "cmovnc", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_32 },
+    { "cmovnc", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_64 },
+    { "cmovae", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_16 },
+    { "cmovae", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_32 },
+    { "cmovae", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x43, 0x00 }, I_DATA_64 },
+
+    { "cmove", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_16 },
+    { "cmove", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_32 },
+    { "cmove", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_64 },
+    { "cmovz", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_16 },
+    { "cmovz", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_32 },
+    { "cmovz", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x44, 0x00 }, I_DATA_64 },
+
+    { "cmovne", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_16 },
+    { "cmovne", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_32 },
+    { "cmovne", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_64 },
+    { "cmovnz", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_16 },
+    { "cmovnz", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_32 },
+    { "cmovnz", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x45, 0x00 }, I_DATA_64 },
+
+    { "cmovbe", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_16 },
+    { "cmovbe", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_32 },
+    { "cmovbe", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_64 },
+    { "cmovna", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_16 },
+    { "cmovna", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_32 },
+    { "cmovna", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x46, 0x00 }, I_DATA_64 },
+
+    { "cmovnbe", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_16 },
+    { "cmovnbe", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_32 },
+    { "cmovnbe", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_64 },
+    { "cmova", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_16 },
+    { "cmova", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_32 },
+    { "cmova", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x47, 0x00 }, I_DATA_64 },
+
+    { "cmovs", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x48, 0x00 }, I_DATA_16 },
+    { "cmovs", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x48, 0x00 }, I_DATA_32 },
+    { "cmovs", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x48, 0x00 }, I_DATA_64 },
+
+    { "cmovns", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x49, 0x00 }, I_DATA_16 },
+    { "cmovns", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x49, 0x00 }, I_DATA_32 },
+    { "cmovns", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x49, 0x00 }, I_DATA_64 },
+
+    { "cmovp", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_16 },
+    { "cmovp", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_32 },
+    { "cmovp", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_64 },
+    { "cmovpe", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_16 },
+    { "cmovpe", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_32 },
+    { "cmovpe", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4A, 0x00 }, I_DATA_64 },
+
+    { "cmovnp", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_16 },
+    { "cmovnp", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_32 },
+    { "cmovnp", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_64 },
+    { "cmovpo", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_16 },
+    { "cmovpo", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_32 },
+    { "cmovpo", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4B, 0x00 }, I_DATA_64 },
+
+    { "cmovl", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_16 },
+    { "cmovl", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_32 },
+    { "cmovl", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_64 },
+    { "cmovnge", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_16 },
+    { "cmovnge", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_32 },
+    { "cmovnge", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4C, 0x00 }, I_DATA_64 },
+
+    { "cmovnl", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_16 },
+    { "cmovnl", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_32 },
+    { "cmovnl", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_64 },
+    { "cmovge", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_16 },
+    { "cmovge", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_32 },
+    { "cmovge", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4D, 0x00 }, I_DATA_64 },
+
+    { "cmovle", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_16 },
+    { "cmovle", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_32 },
+    { "cmovle", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_64 },
+    { "cmovng", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_16 },
+    { "cmovng", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_32 },
+    { "cmovng", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4E, 0x00 }, I_DATA_64 },
+
+    { "cmovnle", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_16 },
+    { "cmovnle", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_32 },
+    { "cmovnle", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_64 },
+    { "cmovg", 2, { O_REG_16 | O_I_MIDREG, O_MRM_16 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_16 },
+    { "cmovg", 2, { O_REG_32 | O_I_MIDREG, O_MRM_32 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_32 },
+    { "cmovg", 2, { O_REG_64 | O_I_MIDREG, O_MRM_64 | O_I_MODRM }, 3, { 0x0F, 0x4F, 0x00 }, I_DATA_64 },
+
     { "loop", 1, { O_REL_8 }, 1, { 0xE2 }, 0 },
 
     { "cmpsb", 0, { }, 1, { 0xA6 }, 0 },
@@ -613,9 +719,9 @@ struct insn insns[] =
     { "cli", 0, { }, 1, { 0xFA }, 0 },
     { "sti", 0, { }, 1, { 0xFB }, 0 },
     { "cmc", 0, { }, 1, { 0xF5 }, 0 },
-    { "rep", 0, { }, 1, { 0xF3 }, 0 },
+    { "rep", 0, { }, 1, { 0xF3 }, I_PREFIX },
     { "hlt", 0, { }, 1, { 0xF4 }, 0 },
-    { "lock", 0, { }, 1, { 0xF0 }, 0 },
+    { "lock", 0, { }, 1, { 0xF0 }, I_PREFIX },
     { "xlat", 0, { }, 1, { 0xD7 }, 0 },
 
     { "iret", 0, { }, 1, { 0xCF }, I_DATA_16 },
@@ -143,6 +143,14 @@ assemble(void)
         scan();
         nr_operands = 0;
 
+        /* a prefix may share its line with the instruction it prefixes */
+
+        if ((name->insn_entries->insn_flags & I_PREFIX) && (token == NAME) && name_token->insn_entries) {
+            insn = name->insn_entries;
+            encode();
+            continue;
+        }
+
         if (token != '\n') {
             for (;;) {
                 if (nr_operands == MAX_OPERANDS) error("too many operands");
@@ -383,6 +383,7 @@ struct insn
 #define I_DATA_32       0x0000000000000004L  
 #define I_DATA_64       0x0000000000000008L
 
+#define I_PREFIX        0x0100000000000000L     /* is itself a prefix (may precede an insn) */
 #define I_PREFIX_66     0x0200000000000000L     /* 0x66 prefix (precedes REX) */
 #define I_PREFIX_F3     0x0400000000000000L     /* 0xF3 prefix (precedes REX) */
 #define I_PREFIX_F2     0x0800000000000000L     /* 0xF2 prefix (precedes REX) */
@@ -234,8 +234,13 @@ main(int argc, char * argv[])
                 add(&cpp, *argv, NULL);
                 break;
         
+            case 'f':
             case 'g':
             case 'O':
+            case 'l':
+            case 'r':
+            case 's':
+            case 'v':
                 add(&cc1, *argv, NULL);
                 break;
 
@@ -251,6 +256,14 @@ main(int argc, char * argv[])
 
                 break;
 
+            case 'i':
+            case 'p':
+            case 'u':
+                if ((*argv)[2] || !argv[1]) error("malformed %c option", (*argv)[1]);
+                add(&cc1, *argv, argv[1], NULL);
+                ++argv;
+                break;
+
             case 'o':
                 if ((*argv)[2] || !argv[1]) error("malformed output option");
                 if (ld_out) error("duplicate output option");
@@ -29,7 +29,7 @@
 /* place a block on the master list before another block.
    if 'before' is NULL, the block goes at the end. */
 
-static void
+void
 put_block(struct block * block, struct block * before)
 {
     block->next = before;
@@ -50,7 +50,7 @@ put_block(struct block * block, struct block * before)
 
 /* remove a block from the master list. */
 
-static void
+void
 get_block(struct block * block)
 {
     if (block->next)
@@ -83,6 +83,11 @@ new_block(void)
     block->predecessors = NULL;
     block->nr_successors = 0;
     block->nr_predecessors = 0;
+    block->table = NULL;
+    block->rpo = -1;
+    block->idom = NULL;
+    block->loop = NULL;
+    block->depth = 0;
     block->defuses = NULL;
 
     for (i = 0; i < NR_REGS; i++) {
@@ -212,7 +217,7 @@ free_defuses(struct block * block)
 
 /* free an instruction and its operands */
 
-static void
+void
 free_insn(struct insn * insn)
 {
     int i;
@@ -225,7 +230,7 @@ free_insn(struct insn * insn)
 
 /* remove an instruction from its block */
 
-static void
+void
 get_insn(struct block * block, struct insn * insn)
 {
     if (insn->next)
@@ -304,6 +309,15 @@ new_insn(int opcode, ...)
     return insn;
 }
 
+/* return a copy of 'insn' (not in any block) */
+
+struct insn *
+dup_insn(struct insn * insn)
+{
+    return new_insn(insn->opcode, copy_tree(insn->operand[0]),
+                                  copy_tree(insn->operand[1]),
+                                  copy_tree(insn->operand[2]));
+}
 
 /* put an instruction into the instruction list in a block, 
    at the specified position. if 'before' is NULL, the put it last. */
@@ -357,7 +371,7 @@ analyze_insn1(int * regs, int reg)
     if (i == NR_INSN_REGS) error(ERROR_INTERNAL); /* overflow */
 }
 
-static void
+void
 analyze_insn(struct insn * insn)
 {
     int i;
@@ -385,6 +399,28 @@ analyze_insn(struct insn * insn)
     if (insn->opcode & I_DEF_CX) analyze_insn1(insn->regs_defd, R_CX);
     if (insn->opcode & I_DEF_XMM0) analyze_insn1(insn->regs_defd, R_XMM0);
 
+    if (insn->opcode & I_STRING) {
+        analyze_insn1(insn->regs_used, R_SI);
+        analyze_insn1(insn->regs_defd, R_SI);
+        analyze_insn1(insn->regs_used, R_DI);
+        analyze_insn1(insn->regs_defd, R_DI);
+        analyze_insn1(insn->regs_used, R_CX);
+        analyze_insn1(insn->regs_defd, R_CX);
+    }
+
+    if (insn->opcode & I_DEF_MEM) insn->mem_defd = 1;
+    if (insn->opcode & I_USE_MEM) insn->mem_used = 1;
+
+    /* XOR <reg>, <reg> (etc.) zeroes the register: it doesn't really USE it */
+
+    if (    ((insn->opcode == I_XOR) || (insn->opcode == I_SUB) || (insn->opcode == I_PXOR))
+        &&  (insn->operand[0]->op == E_REG) && (insn->operand[1]->op == E_REG)
+        &&  (insn->operand[0]->u.reg == insn->operand[1]->u.reg) )
+    {
+        analyze_insn1(insn->regs_defd, insn->operand[0]->u.reg);
+        return;
+    }
+
     for (i = 0; i < I_NR_OPERANDS(insn->opcode); i++) {
         if (insn->operand[i]->op == E_REG) {
             if (insn->opcode & I_DEF(i)) 
@@ -490,22 +526,95 @@ insn_nr_uses(struct insn * insn)
     return insn_reg_count(insn->regs_used);
 }
 
-/* split a block in half: create a new block, move the latter half of 
-   the insns to the new block, and play with successors to maintain the
-   original flow. used by the register allocator. */
+/* can 'block' be split before 'insn'? not if the condition codes or a 
+   real register (e.g., AX before an IDIV) are live across the seam, since
+   the reconciliation code between the halves could clobber them. I_CALL 
+   doesn't USE the argument registers it's given with -r (or AX, when it 
+   returns a struct), so a call must not be separated from any real 
+   register set since the previous call, either. */
+
+static int
+seam(struct block * block, struct insn * insn)
+{
+    int iregs = (1 << R_IDX(R_BP)) | (1 << R_IDX(R_SP));
+    int fregs = 0;
+    int pending_iregs = 0;
+    int pending_fregs = 0;
+    int cc = 0;
+    struct insn * prev;
+    int reg;
+    int i;
+
+    for (prev = insn->previous; prev && (prev->opcode != I_CALL); prev = prev->previous) {
+        for (i = 0; (i < NR_INSN_REGS) && ((reg = prev->regs_defd[i]) != R_NONE); ++i) {
+            if (R_IS_PSEUDO(reg)) continue;
+
+            if (reg & R_IS_FLOAT)
+                pending_fregs |= 1 << R_IDX(reg);
+            else
+                pending_iregs |= 1 << R_IDX(reg);
+        }
+    }
+
+    for (; insn; insn = insn->next) {
+        if ((insn->opcode & I_USE_CC) && !cc) return 0;
+        if (insn->opcode & I_DEF_CC) cc = 1;
+
+        if (insn->opcode == I_CALL) {
+            if (pending_iregs & ~iregs) return 0;
+            if (pending_fregs & ~fregs) return 0;
+            pending_iregs = pending_fregs = 0;
+        }
+
+        for (i = 0; (i < NR_INSN_REGS) && ((reg = insn->regs_used[i]) != R_NONE); ++i) {
+            if (R_IS_PSEUDO(reg)) continue;
+            if (!(((reg & R_IS_FLOAT) ? fregs : iregs) & (1 << R_IDX(reg)))) return 0;
+        }
+
+        for (i = 0; (i < NR_INSN_REGS) && ((reg = insn->regs_defd[i]) != R_NONE); ++i) {
+            if (R_IS_PSEUDO(reg)) continue;
+
+            if (reg & R_IS_FLOAT)
+                fregs |= 1 << R_IDX(reg);
+            else
+                iregs |= 1 << R_IDX(reg);
+        }
+    }
+
+    return cc || (block->nr_successors < 2);
+}
+
+/* split a block in two: create a new block, move the latter half (or
+   so, see seam() above) of the insns to the new block, and play with 
+   successors to maintain the original flow. used by the allocator. */
 
 void
 split_block(struct block * block)
 {
     struct block * latter;
+    struct insn  * half;
     struct insn  * insn;
+    struct insn  * stop;
     int            cc;
     struct block * successor;
+    int            n;
+
+    for (half = block->first_insn, n = block->nr_insns / 2; n; --n)
+        half = half->next;
+
+    for (insn = half; insn != block->first_insn; insn = insn->previous)
+        if (seam(block, insn)) break;
+
+    if (insn == block->first_insn) 
+        for (insn = half; insn && !seam(block, insn); insn = insn->next) ;
+
+    if ((insn == NULL) || (insn == block->first_insn)) insn = half;
+    stop = insn->previous;
 
     latter = new_block();
     latter->loop_level = block->loop_level;
 
-    while (latter->nr_insns < block->nr_insns) {     /* move roughly half */
+    while (block->last_insn != stop) {
         insn = block->last_insn;
         get_insn(block, insn);
         put_insn(latter, insn, latter->first_insn);
@@ -517,18 +626,32 @@ split_block(struct block * block)
         succeed_block(latter, cc, successor);
     }
 
+    latter->table = block->table;
+    block->table = NULL;
     succeed_block(block, CC_ALWAYS, latter);
 }
 
 /* order and analyze all the instructions, and determine
    some basic register-allocation information for the block. */
 
+static void
+prohibit_reg(struct block * block, int reg)
+{
+    if ((reg == R_NONE) || R_IS_PSEUDO(reg)) return;
+
+    if (reg & R_IS_FLOAT)
+        block->prohibit_fregs |= 1 << R_IDX(reg);
+    else
+        block->prohibit_iregs |= 1 << R_IDX(reg);
+}
+
 static void
 analyze_block(struct block * block)
 {
     struct insn * insn;
     struct insn * last_cc = NULL;
     int           n;
+    int           i;
 
     block->prohibit_iregs = (1 << R_IDX(R_BP)) | (1 << R_IDX(R_SP));
     block->temponly_iregs = (   (1 << R_IDX(R_AX)) 
@@ -542,14 +665,13 @@ analyze_block(struct block * block)
         insn->n = n;
         analyze_insn(insn);
 
-        if (insn_touches_reg(insn, R_AX)) 
-            block->prohibit_iregs |= 1 << R_IDX(R_AX);
-        if (insn_touches_reg(insn, R_DX)) 
-            block->prohibit_iregs |= 1 << R_IDX(R_DX);
-        if (insn_touches_reg(insn, R_CX)) 
-            block->prohibit_iregs |= 1 << R_IDX(R_CX);
-        if (insn_touches_reg(insn, R_XMM0)) 
-            block->prohibit_fregs |= 1 << R_IDX(R_XMM0);
+        /* any real register referenced explicitly (usually AX, CX, DX or 
+           XMM0, but with -r, any of the argument registers) is off-limits */
+
+        for (i = 0; i < NR_INSN_REGS; ++i) {
+            prohibit_reg(block, insn->regs_used[i]);
+            prohibit_reg(block, insn->regs_defd[i]);
+        }
 
         if ((insn->opcode & I_USE_CC) && last_cc) 
             last_cc->flags |= INSN_FLAG_CC;
@@ -567,7 +689,7 @@ analyze_block(struct block * block)
    block, then it isn't subject to a temponly restriction. this mainly
    opens up AX, CX, DX and XMM0 in leaf routines to global allocation. */
 
-static void
+void
 analyze_blocks(void)
 {
     struct block * block;
@@ -755,6 +877,48 @@ compute_global_defuses(void)
     } while (changes);
 }
 
+/* recompute the local def/use data of 'block' after its insns have been 
+   changed, keeping the global data about what's live in and out. that's 
+   only valid if the changes don't alter which values cross the block's 
+   boundaries, e.g., propagating, renaming or removing USEs inside it. 
+   a live-in/out flag left stale only makes the optimizers conservative. */
+
+void
+update_defuses(struct block * block)
+{
+    struct defuse ** defusep;
+    struct defuse  * defuse;
+    struct insn    * insn;
+    int              n;
+
+    for (insn = block->first_insn, n = 1; insn; insn = insn->next, ++n) {
+        insn->n = n;
+        analyze_insn(insn);
+    }
+
+    for (defuse = block->defuses; defuse; defuse = defuse->link) {
+        defuse->dus &= DU_IN | DU_OUT;
+        defuse->first_n = 0;
+        defuse->last_n = 0;
+    }
+
+    for (insn = block->first_insn; insn; insn = insn->next) {
+        compute_block_defuses1(block, insn, DU_USE);
+        compute_block_defuses1(block, insn, DU_DEF);
+    }
+
+    defusep = &block->defuses;
+
+    while (defuse = *defusep) {
+        if (defuse->dus) 
+            defusep = &defuse->link;
+        else {
+            *defusep = defuse->link;
+            free(defuse);
+        }
+    }
+}
+
 /* is 'reg' dead after 'insn' in 'block'?
    a [pseudo] register is considered dead if:
    1. it's S_REGISTER, 
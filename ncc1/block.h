@@ -25,6 +25,10 @@
 #define B_SEQ           0x00000001          /* sequenced */
 #define B_REG           0x00000002          /* registers allocated */
 #define B_RECON         0x00000004          /* reconciliation block */
+#define B_DEPTH         0x00000008          /* 'depth' is valid */
+#define B_CACHE         0x00000010          /* rewritten (see rewrite() [reg.c]) */
+#define B_UNROLLED      0x00000020          /* unrolled (see unroll() [loop.c]) */
+#define B_ARGUMENTS     0x00000040          /* reads register arguments [decl.c] */
 
 struct block
 {
@@ -40,6 +44,11 @@ struct block
     struct block_list * predecessors;
     int                 nr_successors;
     int                 nr_predecessors;
+    struct symbol     * table;      /* jump table (CC_TABLE successors) */
+    int                 rpo;        /* reverse postorder (-1: unreachable) */
+    struct block      * idom;       /* immediate dominator */
+    struct loop       * loop;       /* innermost containing loop */
+    int                 depth;      /* stack depth at entry (see logues()) */
     struct defuse     * defuses;
     struct symbol     * iregs[NR_REGS];
     struct symbol     * fregs[NR_REGS];
@@ -55,6 +64,17 @@ struct block
     int                 temponly_fregs;
 };
 
+/* the loop forest is computed by find_loops() [loop.c]. the 'idom', 
+   'rpo' and 'loop' fields of blocks are only valid in its wake. */
+
+struct loop
+{
+    struct block      * header;
+    struct loop       * parent;     /* enclosing loop (or NULL) */
+    struct loop       * next;       /* in 'loops' */
+    int                 depth;      /* 1 for outermost loops */
+};
+
 /* for successors, 'cc' is the branch condition that leads to
    the successor. (predecessors have 'cc' = CC_NONE.)
 
@@ -101,6 +121,12 @@ struct block_list
 
 #define CC_NONE         12
 
+/* a block that ends in an indirect I_JMP through a jump table has a
+   successor for each entry in the table: entry n has 'cc' CC_TABLE + n.
+   the successors may be duplicates. */
+
+#define CC_TABLE        13
+
 /* def/use, live variable information tracking and other sundries. */
 
 struct defuse
@@ -111,6 +137,7 @@ struct defuse
     int             reg;
     int             cache;      /* DU_CACHE */
     int             con;        /* if DU_CON; see con_prop() [opt.c] */
+    int             ext;        /* see extensions() [opt.c] */
             
     /* first_n and last_n give the insn indexes (insn->n) of the first
        and last appearances of the symbol in the block.  if the symbol 
@@ -155,6 +182,7 @@ struct defuse
 #define NR_INSN_REGS        (NR_INSN_OPERANDS * 2)  /* maximum # of registers referenced in one insn */
 
 #define INSN_FLAG_CC    0x00000001  /* condition codes from this insn used */
+#define INSN_FLAG_TAIL  0x00000002  /* I_CALL that could be a tail call */
 
 struct insn
 {
@@ -213,68 +241,100 @@ struct insn
 #define I_DEF_CC                (1 << 24)
 #define I_USE_CC                (1 << 25)
 
+    /* I[27:26] indicate which operands may be E_MEM, and I[29:28] which
+       may be E_CON, when other optimizations substitute operands. these
+       are conservative: an insn never takes more than one E_MEM operand,
+       and E_CONs must fit in 32 bits (sign-extended) regardless. */
+
+#define I_MEM(i)                (1 << (26 + (i)))
+#define I_CON(i)                (1 << (28 + (i)))
+
+    /* I[30] marks the string instructions, which implicitly use and def
+       RSI, RDI and RCX (and should also carry I_DEF_MEM and/or I_USE_MEM) */
+
+#define I_STRING                (1 << 30)
+
     /* the instructions */
 
 #define I_NONE      (   0 | I_0_OPERANDS )
-#define I_MOV       (   1 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_MOVSX     (   2 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_MOVZX     (   3 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_MOVSS     (   4 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_MOVSD     (   5 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
+#define I_MOV       (   1 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_MOVSX     (   2 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_MOVZX     (   3 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_MOVSS     (   4 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(0) | I_MEM(1) )
+#define I_MOVSD     (   5 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(0) | I_MEM(1) )
 #define I_LEA       (   6 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CMP       (   7 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_UCOMISS   (   8 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_UCOMISD   (   9 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC )
+#define I_CMP       (   7 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_UCOMISS   (   8 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(1) )
+#define I_UCOMISD   (   9 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(1) )
 #define I_PXOR      (  10 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_CVTSS2SI  (  11 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CVTSD2SI  (  12 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CVTSI2SS  (  13 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CVTSI2SD  (  14 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CVTSS2SD  (  15 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_CVTSD2SS  (  16 | I_2_OPERANDS | I_DEF(0) | I_USE(1) )
-#define I_SHL       (  17 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_SHR       (  18 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_SAR       (  19 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_ADD       (  20 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_ADDSS     (  21 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_ADDSD     (  22 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_SUB       (  23 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_SUBSS     (  24 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_SUBSD     (  25 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_IMUL      (  26 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_MULSS     (  27 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_MULSD     (  28 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_OR        (  29 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_XOR       (  30 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
-#define I_AND       (  31 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC )
+#define I_CVTSS2SI  (  11 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_CVTSD2SI  (  12 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_CVTSI2SS  (  13 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_CVTSI2SD  (  14 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_CVTSS2SD  (  15 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_CVTSD2SS  (  16 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_MEM(1) )
+#define I_SHL       (  17 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_CON(1) )
+#define I_SHR       (  18 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_CON(1) )
+#define I_SAR       (  19 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_CON(1) )
+#define I_ADD       (  20 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_ADDSS     (  21 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_ADDSD     (  22 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_SUB       (  23 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_SUBSS     (  24 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_SUBSD     (  25 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_IMUL      (  26 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(1) | I_CON(1) )
+#define I_MULSS     (  27 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_MULSD     (  28 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_OR        (  29 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_XOR       (  30 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
+#define I_AND       (  31 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_MEM(1) | I_CON(1) )
 #define I_CDQ       (  32 | I_0_OPERANDS | I_USE_AX | I_DEF_DX ) 
 #define I_CQO       (  33 | I_0_OPERANDS | I_USE_AX | I_DEF_DX )
-#define I_DIV       (  34 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_USE_DX | I_DEF_DX | I_DEF_CC )
-#define I_IDIV      (  35 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_USE_DX | I_DEF_DX | I_DEF_CC )
-#define I_DIVSS     (  36 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
-#define I_DIVSD     (  37 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) )
+#define I_DIV       (  34 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_USE_DX | I_DEF_DX | I_DEF_CC | I_MEM(0) )
+#define I_IDIV      (  35 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_USE_DX | I_DEF_DX | I_DEF_CC | I_MEM(0) )
+#define I_DIVSS     (  36 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
+#define I_DIVSD     (  37 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_MEM(1) )
 #define I_CBW       (  38 | I_0_OPERANDS | I_USE_AX | I_DEF_AX )
 #define I_CWD       (  39 | I_0_OPERANDS | I_USE_AX | I_DEF_AX | I_DEF_DX )
-#define I_SETZ      (  40 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETNZ     (  41 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETG      (  42 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETLE     (  43 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETGE     (  44 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETL      (  45 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETA      (  46 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETBE     (  47 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETAE     (  48 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_SETB      (  49 | I_1_OPERANDS | I_DEF(0) | I_USE_CC )
-#define I_NOT       (  50 | I_1_OPERANDS | I_DEF(0) | I_USE(0) )
-#define I_NEG       (  51 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC )
-#define I_PUSH      (  52 | I_1_OPERANDS | I_USE(0) )
-#define I_POP       (  53 | I_1_OPERANDS | I_DEF(0) )
-#define I_CALL      (  54 | I_1_OPERANDS | I_USE(0) | I_DEF_AX | I_DEF_CX | I_DEF_DX | I_DEF_XMM0 | I_DEF_CC )
-#define I_TEST      (  55 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC )
+#define I_SETZ      (  40 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETNZ     (  41 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETG      (  42 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETLE     (  43 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETGE     (  44 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETL      (  45 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETA      (  46 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETBE     (  47 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETAE     (  48 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_SETB      (  49 | I_1_OPERANDS | I_DEF(0) | I_USE_CC | I_MEM(0) )
+#define I_NOT       (  50 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_MEM(0) )
+#define I_NEG       (  51 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC | I_MEM(0) )
+#define I_PUSH      (  52 | I_1_OPERANDS | I_USE(0) | I_MEM(0) | I_CON(0) )
+#define I_POP       (  53 | I_1_OPERANDS | I_DEF(0) | I_MEM(0) )
+#define I_CALL      (  54 | I_1_OPERANDS | I_USE(0) | I_DEF_AX | I_DEF_CX | I_DEF_DX | I_DEF_XMM0 | I_DEF_CC | I_MEM(0) )
+#define I_TEST      (  55 | I_2_OPERANDS | I_USE(0) | I_USE(1) | I_DEF_CC | I_MEM(0) | I_CON(1) )
 #define I_RET       (  56 | I_0_OPERANDS )
-#define I_INC       (  57 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC )
-#define I_DEC       (  58 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC )
+#define I_INC       (  57 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC | I_MEM(0) )
+#define I_DEC       (  58 | I_1_OPERANDS | I_DEF(0) | I_USE(0) | I_DEF_CC | I_MEM(0) )
+#define I_JMP       (  59 | I_1_OPERANDS | I_USE(0) | I_MEM(0) )
+#define I_REP_MOVSQ (  60 | I_0_OPERANDS | I_STRING | I_DEF_MEM | I_USE_MEM )
+
+    /* the one-operand (widening) multiplies: RDX:RAX = RAX * operand */
+
+#define I_MUL       (  61 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_DEF_DX | I_DEF_CC | I_MEM(0) )
+#define I_IMUL1     (  62 | I_1_OPERANDS | I_USE(0) | I_USE_AX | I_DEF_AX | I_DEF_DX | I_DEF_CC | I_MEM(0) )
+
+    /* conditional moves, indexed by CC_* like the SETcc insns (I_CMOVZ + cc) */
+
+#define I_CMOVZ     (  63 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVNZ    (  64 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVG     (  65 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVLE    (  66 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVGE    (  67 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVL     (  68 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVA     (  69 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVBE    (  70 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVAE    (  71 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
+#define I_CMOVB     (  72 | I_2_OPERANDS | I_DEF(0) | I_USE(0) | I_USE(1) | I_USE_CC | I_MEM(1) )
 
 #define I_ANY       ( 200 | I_0_OPERANDS )
-#define I_BLKCPY    ( 201 | I_2_OPERANDS | I_DEF(0) | I_USE(1) | I_DEF_AX | I_DEF_CX | I_DEF_DX | I_DEF_CC )
 
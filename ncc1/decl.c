@@ -739,14 +739,44 @@ compute_offset(struct symbol * symbol)
     frame_offset = ROUND_UP(frame_offset, FRAME_ALIGN);
 }
 
+/* with -r, arguments passed in registers are treated like locals,
+   and are assigned from their incoming registers on entry. */
+
+static struct symbol * incoming[NR_IARGUMENT_REGS + NR_FARGUMENT_REGS];
+static int             incoming_regs[NR_IARGUMENT_REGS + NR_FARGUMENT_REGS];
+static int             nr_incoming;
+
+static void
+place_argument(struct symbol * arg, int * nr_iregs, int * nr_fregs)
+{
+    int reg = R_NONE;
+
+    if (register_arguments(current_function->type)) 
+        reg = argument_reg(arg->type, nr_iregs, nr_fregs);
+
+    if (reg == R_NONE) 
+        compute_offset(arg);
+    else {
+        incoming[nr_incoming] = arg;
+        incoming_regs[nr_incoming] = reg;
+        ++nr_incoming;
+    }
+}
+
 static void
 function_definition(struct symbol * symbol, struct symbol * old_args)
 {
     struct symbol * arg;
+    FILE          * text;
+    int             prototyped;
+    int             nr_iregs = 0;
+    int             nr_fregs = 0;
+    int             i;
 
     if (symbol->ss & S_DEFINED) error(ERROR_DUPDEF);
     current_function = symbol;
     frame_offset = FRAME_ARGUMENTS;
+    nr_incoming = 0;
 
     /* if the function returns a struct, the caller will pass in a
        pointer to the struct, and we stash it in an unnamed temporary. */
@@ -756,11 +786,15 @@ function_definition(struct symbol * symbol, struct symbol * old_args)
     else
         return_struct_temp = NULL;
 
+    return_struct_local = NULL;
+
     /* parse types of old-style arguments already in SCOPE_FUNCTION,
        or import new-style arguments into SCOPE_FUNCTION, and compute
        their frame addresses */
 
-    if (old_args || !current_function->type->proto || (current_function->type->proto->ps & P_STALE)) {
+    prototyped = !old_args && current_function->type->proto && !(current_function->type->proto->ps & P_STALE);
+
+    if (!prototyped) {
         declarations(declare_argument, 0, old_args);
 
         for (arg = old_args; arg; arg = arg->list) {
@@ -768,22 +802,50 @@ function_definition(struct symbol * symbol, struct symbol * old_args)
                 arg->type = new_type(T_INT);
                 arg->ss = S_LOCAL;
             }
-            compute_offset(arg);
+            place_argument(arg, &nr_iregs, &nr_fregs);
         }
     } else {
         for (arg = current_function->type->proto->args; arg; arg = arg->list) {
             if (arg->id == NULL) error(ERROR_ARGNAME);
             symbol = new_symbol(arg->id, arg->ss, copy_type(arg->type));
-            compute_offset(symbol);
+            place_argument(symbol, &nr_iregs, &nr_fregs);
             put_symbol(symbol, SCOPE_FUNCTION);
         }
     }
 
+    arguments_size = frame_offset - FRAME_ARGUMENTS;
     frame_offset = 0;
     setup_blocks();
+
+    /* if the function returns a struct/union, we need to save the 
+       return-struct pointer (which is passed by the caller in RAX) 
+       in the temporary allocated for that purpose before doing 
+       anything else. likewise any arguments passed in registers: 
+       they're read in a block of their own, which needs no more
+       registers than it reads, and so is never split. */
+
+    if (return_struct_temp) 
+        choose(E_ASSIGN, copy_tree(return_struct_temp), reg_tree(R_AX, new_type(T_LONG)));
+
+    if (nr_incoming) {
+        for (i = 0; i < nr_incoming; ++i) {
+            arg = incoming[i];
+            choose(E_ASSIGN, reg_tree(symbol_reg(arg), copy_type(arg->type)), 
+                             reg_tree(incoming_regs[i], copy_type(arg->type)));
+        }
+
+        current_block->bs |= B_ARGUMENTS;
+        succeed_block(current_block, CC_ALWAYS, new_block());
+        current_block = block_successor(current_block, 0);
+    }
+
+    inline_begin(prototyped);
     compound();         /* will enter_scope() to capture arguments at SCOPE_FUNCTION */
+    text = inline_end();
+    if (text) text = divert(text);
     optimize();
     output_function();
+    if (text) divert(text);
     free_blocks();
     free_symbols();
     current_function->ss |= S_DEFINED;
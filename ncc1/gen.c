@@ -23,13 +23,14 @@
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include <limits.h>
+#include <stdlib.h>
 #include "ncc1.h"
 
 /* normalize a node after we've messed with its contents. 
    at present, that means after folding integral constants
    in E_CONs or removing elements of E_IMMs. */
 
-static void
+void
 normalize(struct tree * tree)
 {
     long  i;
@@ -243,6 +244,64 @@ operand(struct tree * tree)
     return tree;
 }
 
+/* block copies (struct and array assignment). small copies are done
+   inline through temporaries, biggest pieces first, which leaves them
+   exposed to the optimizer. anything larger uses REP MOVSQ, with any
+   odd bytes left over copied inline as before. */
+
+#define BLKCPY_INLINE   64      /* largest copy done with MOVs alone */
+
+static struct tree *
+piece(struct tree * tree, int ts, long ofs)
+{
+    tree = copy_tree(tree);
+    free_type(tree->type);
+    tree->type = new_type(ts);
+    tree->u.mi.ofs += ofs;
+    return tree;
+}
+
+static void
+blkcpy(struct tree * dst, struct tree * src)
+{
+    struct tree * temp;
+    long          size;
+    long          ofs;
+    int           ts;
+
+    dst = operand(dst);
+    src = operand(src);
+    size = size_of(dst->type);
+    ofs = 0;
+
+    if (size > BLKCPY_INLINE) {
+        emit(new_insn(I_LEA, reg_tree(R_DI, new_type(T_LONG)), piece(dst, T_LONG, 0)));
+        emit(new_insn(I_LEA, reg_tree(R_SI, new_type(T_LONG)), piece(src, T_LONG, 0)));
+        emit(new_insn(I_MOV, reg_tree(R_CX, new_type(T_INT)), int_tree(T_INT, size / 8)));
+        emit(new_insn(I_REP_MOVSQ));
+        ofs = size & ~7L;
+    }
+
+    while (ofs < size) {
+        if ((size - ofs) >= 8) 
+            ts = T_LONG;
+        else if ((size - ofs) >= 4) 
+            ts = T_INT;
+        else if ((size - ofs) >= 2) 
+            ts = T_SHORT;
+        else 
+            ts = T_CHAR;
+
+        temp = temporary(new_type(ts));
+        emit(new_insn(I_MOV, copy_tree(temp), piece(src, ts, ofs)));
+        emit(new_insn(I_MOV, piece(dst, ts, ofs), temp));
+        ofs += size_of(temp->type);
+    }
+
+    free_tree(dst);
+    free_tree(src);
+}
+
 /* given a tree 'op' and two operand trees, emit the first match in the
    table. an entry is considered a match when the 'op' is the same and the 
    operands' type bits are "covered" by the corresponding masks. 
@@ -262,8 +321,6 @@ static struct
     { E_ASSIGN, T_IS_INTEGRAL | T_PTR, T_IS_INTEGRAL | T_PTR, I_MOV },
     { E_ASSIGN, T_FLOAT, T_FLOAT, I_MOVSS },
     { E_ASSIGN, T_DOUBLE | T_LDOUBLE, T_DOUBLE | T_LDOUBLE, I_MOVSD },
-    { E_ASSIGN, T_TAG, T_TAG, I_BLKCPY },
-    { E_ASSIGN, T_ARRAY, T_ARRAY, I_BLKCPY },
 
     { E_EQ, T_IS_INTEGRAL | T_PTR, T_IS_INTEGRAL | T_PTR, I_CMP },
     { E_EQ, T_FLOAT, T_FLOAT, I_UCOMISS },
@@ -319,6 +376,11 @@ choose(int op, struct tree * left, struct tree * right)
 {
     int i;
 
+    if ((op == E_ASSIGN) && (left->type->ts & (T_TAG | T_ARRAY))) {
+        blkcpy(left, right);
+        return 1;
+    }
+
     for (i = 0; i < NR_CHOICES; i++) {
         if (choices[i].op != op) continue;
         if (!(choices[i].left_ts & left->type->ts)) continue;
@@ -446,12 +508,15 @@ extract_field(struct tree * tree)
 
     if ((tree->op != E_MEM) || !(tree->type->ts & T_FIELD)) error(ERROR_INTERNAL);
 
-    tree->type->ts &= T_BASE;
+    tree->type->ts &= T_BASE | T_VOLATILE;
     temp = temporary(copy_type(tree->type));
     temp_bits = size_of(temp->type) * BITS;
 
     choose(E_ASSIGN, copy_tree(temp), tree);
-    choose(E_SHL, copy_tree(temp), int_tree(T_INT, temp_bits - shift - size));
+
+    if (temp_bits - shift - size)
+        choose(E_SHL, copy_tree(temp), int_tree(T_INT, temp_bits - shift - size));
+
     choose(E_SHR, copy_tree(temp), int_tree(T_INT, temp_bits - size)); 
 
     return temp;
@@ -472,12 +537,17 @@ insert_field(struct tree * tree, struct tree * value, int goal, int * cc)
     long          shift = T_GET_SHIFT(tree->type->ts);
     long          size = T_GET_SIZE(tree->type->ts);
     long          value_bits;
+    long          value_mask;
+    int           ts;
 
     if ((tree->op != E_MEM) || !(tree->type->ts & T_FIELD)) error(ERROR_INTERNAL);
 
+    /* (a shift by 64 bits is undefined, so long fields need care) */
+
     value_bits = size_of(value->type) * BITS;
-    source_mask = ~(-1L << size) & ~(-1L << value_bits);
-    target_mask = ~(source_mask << shift) & ~(-1L << value_bits);
+    value_mask = (value_bits < 64) ? ~(-1L << value_bits) : -1L;
+    source_mask = (size < 64) ? ~(-1L << size) & value_mask : value_mask;
+    target_mask = ~(source_mask << shift) & value_mask;
 
     if (value->op == E_CON) {
         value->u.con.i &= source_mask;
@@ -486,15 +556,35 @@ insert_field(struct tree * tree, struct tree * value, int goal, int * cc)
     } else {
         temp = temporary(copy_type(value->type));
         choose(E_ASSIGN, copy_tree(temp), value);
-        choose(E_AND, copy_tree(temp), int_tree(temp->type->ts, source_mask));
-        choose(E_SHL, copy_tree(temp), int_tree(temp->type->ts, shift));
+
+        if (shift + size < value_bits)
+            choose(E_AND, copy_tree(temp), int_tree(temp->type->ts, source_mask));
+
+        if (shift) choose(E_SHL, copy_tree(temp), int_tree(temp->type->ts, shift));
         source = temp;
     } 
 
+    /* an unsigned int constant with its high bit set won't fit in an 
+       immediate, but the same bits as an int will. as in extract_field(), 
+       the word keeps its volatility, so the optimizer leaves it alone. */
+
     original_tree = copy_tree(tree);
-    tree->type->ts &= T_BASE;
-    choose(E_AND, copy_tree(tree), int_tree(tree->type->ts, target_mask));
-    choose(E_OR, tree, copy_tree(source));
+    tree->type->ts &= T_BASE | T_VOLATILE;
+    ts = tree->type->ts & T_BASE;
+
+    if (ts == T_UINT) {
+        ts = T_INT;
+        target_mask = (int) target_mask;
+    }
+
+    choose(E_AND, copy_tree(tree), int_tree(ts, target_mask));
+
+    if (source->op != E_CON)
+        choose(E_OR, tree, copy_tree(source));
+    else if (source->u.con.i)
+        choose(E_OR, tree, int_tree(ts, (ts == T_INT) ? (int) source->u.con.i : source->u.con.i));
+    else
+        free_tree(tree);
 
     switch (goal)
     {
@@ -690,8 +780,45 @@ generate_ternary(struct tree * tree, int goal, int * cc)    /* E_TERN */
         return NULL;
 }
 
-static struct tree * 
-generate_call(struct tree * tree, int goal, int * cc)       /* E_CALL */
+/* with -r, prototyped functions that aren't variadic take their first 
+   scalar arguments in registers, much like the System V ABI: integral
+   and pointer arguments in RDI, RSI, RDX, RCX, R8 and R9, and floating-
+   point arguments in XMM0 through XMM7. structs are still pushed. the
+   caller and callee must agree, so everything in a program (including
+   any libraries) must be compiled the same way. */
+
+static int iargument_regs[NR_IARGUMENT_REGS] = { R_DI, R_SI, R_DX, R_CX, R_8, R_9 };
+
+int
+register_arguments(struct type * type)      /* T_FUNC */
+{
+    return r_flag && type->proto && !(type->proto->ps & P_VARIADIC);
+}
+
+/* return the register in which the next argument of 'type' is passed, 
+   or R_NONE if it goes on the stack. the caller supplies the counts of 
+   the integral and floating-point registers already assigned. */
+
+int
+argument_reg(struct type * type, int * nr_iregs, int * nr_fregs)
+{
+    if (type->ts & T_TAG) return R_NONE;
+
+    if (type->ts & T_IS_FLOAT) {
+        if (*nr_fregs < NR_FARGUMENT_REGS) return R_XMM0 + (*nr_fregs)++;
+    } else {
+        if (*nr_iregs < NR_IARGUMENT_REGS) return iargument_regs[(*nr_iregs)++];
+    }
+
+    return R_NONE;
+}
+
+/* generate a call. if it returns a struct, 'target' (an E_MEM) may
+   be supplied, and the result is constructed there directly, in place
+   of the usual temporary. see unseen() and generate_init(). */
+
+static struct tree *
+call(struct tree * tree, struct tree * target, int goal, int * cc)
 {
     struct tree   * function;
     struct tree   * arguments;
@@ -701,17 +828,64 @@ generate_call(struct tree * tree, int goal, int * cc)       /* E_CALL */
     int             stack_adjust = 0;
     int             argument_size;
     struct symbol * return_struct;
+    struct tree  ** reg_arguments = NULL;
+    int           * argument_regs = NULL;
+    struct insn   * insn;
+    int             nr_arguments = 0;
+    int             nr_iregs = 0;
+    int             nr_fregs = 0;
+    int             i;
 
     decap_tree(tree, &type, &function, &arguments, NULL);
+
+    if (O_flag && (tree = inline_call(function, arguments))) {
+        free_type(type);
+        free_tree(function);
+        free_tree(arguments);
+
+        if (target) {
+            choose(E_ASSIGN, copy_tree(target), generate(tree, GOAL_VALUE, NULL));
+            return generate_leaf(target, goal, cc);
+        }
+
+        return generate(tree, goal, cc);
+    }
+
+    /* the arguments are in reverse order, but registers are assigned 
+       from the first argument, so figure out which go where up front. */
+
+    if (register_arguments(function->type->next)) {
+        for (argument = arguments; argument; argument = argument->list) ++nr_arguments;
+        reg_arguments = allocate(sizeof(struct tree *) * (nr_arguments + 1));
+        argument_regs = allocate(sizeof(int) * (nr_arguments + 1));
+
+        for (i = nr_arguments - 1, argument = arguments; argument; --i, argument = argument->list)
+            reg_arguments[i] = argument;
+
+        for (i = 0; i < nr_arguments; ++i) 
+            argument_regs[i] = argument_reg(reg_arguments[i]->type, &nr_iregs, &nr_fregs);
+    }
+
     function = generate(function, GOAL_VALUE, NULL);
 
-    while (argument = arguments)
+    for (i = nr_arguments - 1; argument = arguments; --i)
     {
         arguments = argument->list;
         argument->list = NULL;
         argument = generate(argument, GOAL_VALUE, 0);
         argument = operand(argument);
 
+        if (argument_regs && (argument_regs[i] != R_NONE)) {
+            /* register arguments are evaluated into temporaries, and only
+               moved into place just before the call, since evaluating
+               the other arguments may involve calls of their own. as with
+               pushed arguments, the callee ignores any excess upper bits. */
+
+            if ((argument->op != E_REG) && (argument->op != E_CON)) argument = load(argument);
+            reg_arguments[i] = argument;
+            continue;
+        }
+
         if (argument->type->ts & T_TAG) {
             argument_size = size_of(argument->type);
             argument_size = ROUND_UP(argument_size, FRAME_ALIGN);
@@ -766,24 +940,49 @@ generate_call(struct tree * tree, int goal, int * cc)       /* E_CALL */
     function = operand(function);
 
     /* if the function returns a struct, we allocate a 
-       temporary struct to hold the return value, and
-       pass its address to the function in RAX */
+       temporary struct to hold the return value (unless
+       we have a target), and pass its address in RAX */
 
     if (type->ts & T_TAG) {
-        return_struct = temporary_symbol(copy_type(type));
-        tree = addr_tree(memory_tree(return_struct));
+        if (target)
+            tree = addr_tree(copy_tree(target));
+        else {
+            return_struct = temporary_symbol(copy_type(type));
+            tree = addr_tree(memory_tree(return_struct));
+        }
+
         tree = generate(tree, GOAL_VALUE, 0);
         tree = operand(tree);
-        emit(new_insn(I_MOV, tree, reg_tree(R_AX, new_type(T_LONG))));
+        emit(new_insn(I_MOV, reg_tree(R_AX, new_type(T_LONG)), tree));
     }
 
-    emit(new_insn(I_CALL, function));
+    /* the call can be made into a tail call by logues() if the callee 
+       doesn't return a struct into our frame, and doesn't expect arguments
+       in registers that our epilogue would restore. (since I_CALL doesn't
+       DEF them, the callee must preserve them for our caller, too.) */
+
+    insn = new_insn(I_CALL, function);
+    if (!(type->ts & T_TAG)) insn->flags |= INSN_FLAG_TAIL;
+
+    if (argument_regs) {
+        for (i = 0; i < nr_arguments; ++i) {
+            if (argument_regs[i] == R_NONE) continue;
+            if ((argument_regs[i] != R_CX) && (argument_regs[i] != R_DX)) insn->flags &= ~INSN_FLAG_TAIL;
+            argument = reg_arguments[i];
+            choose(E_ASSIGN, reg_tree(argument_regs[i], copy_type(argument->type)), argument);
+        }
+
+        free(reg_arguments);
+        free(argument_regs);
+    }
+
+    emit(insn);
     if (stack_adjust) emit(new_insn(I_ADD, reg_tree(R_SP, new_type(T_LONG)), int_tree(T_LONG, (long) stack_adjust)));
 
     if (type->ts & T_VOID) 
         tree = new_tree(E_NOP, type);
     else if (type->ts & T_TAG)
-        tree = memory_tree(return_struct);
+        tree = target ? target : memory_tree(return_struct);
     else { 
         tree = temporary(type);
         reg = (tree->type->ts & T_IS_FLOAT) ? R_XMM0 : R_AX;
@@ -793,6 +992,12 @@ generate_call(struct tree * tree, int goal, int * cc)       /* E_CALL */
     return generate_leaf(tree, goal, cc);
 }
 
+static struct tree * 
+generate_call(struct tree * tree, int goal, int * cc)       /* E_CALL */
+{
+    return call(tree, NULL, goal, cc);
+}
+
 static struct tree *
 generate_relational(struct tree * tree, int goal, int * cc) /* E_GT E_LT E_EQ E_NEQ E_GTEQ E_LTEQ */
 {
@@ -1103,6 +1308,30 @@ generate_fetch(struct tree * tree, int goal, int * cc, int lvalue)      /* E_FET
     return generate_leaf(tree, goal, cc);
 }
 
+/* a call returning a struct can construct its result directly in the
+   left side of an assignment only if the callee can't see it there, 
+   i.e., it's a local whose address hasn't been taken. the address may
+   yet be taken later in the function, so there must also be no way to
+   get back here from later: no enclosing loop, and no label before. */
+
+static int labeled;
+
+static void
+unseen1(struct symbol * symbol)
+{
+    if ((symbol->ss & S_LABEL) && (symbol->ss & S_DEFINED)) labeled = 1;
+}
+
+static int
+unseen(struct tree * tree)
+{
+    if ((tree->op != E_SYM) || !(tree->u.sym->ss & S_LOCAL) || loop_level) return 0;
+
+    labeled = 0;
+    walk_symbols(SCOPE_FUNCTION, SCOPE_FUNCTION, unseen1);
+    return !labeled;
+}
+
 static struct tree *
 generate_assign(struct tree * tree, int goal, int * cc)     /* E_ASSIGN */
 {
@@ -1110,6 +1339,12 @@ generate_assign(struct tree * tree, int goal, int * cc)     /* E_ASSIGN */
     struct tree * right;
 
     decap_tree(tree, NULL, &left, &right, NULL);
+
+    if ((right->op == E_CALL) && (left->type->ts & T_TAG) && unseen(left)) {
+        left = generate(left, GOAL_VALUE, NULL);
+        return call(right, left, goal, cc);
+    }
+
     right = generate(right, GOAL_VALUE, NULL);
 
     if (left->type->ts & T_FIELD) {
@@ -1154,6 +1389,158 @@ generate_sym(struct tree * tree, int goal, int * cc)        /* E_SYM */
     return tree;
 }
 
+/* division by a constant is replaced by multiplication by its 'magic'
+   reciprocal: the high half of the product, shifted and corrected, is the
+   quotient. these are the algorithms from Warren, "Hacker's Delight" (2nd
+   ed., ch. 10), for operations 'bits' (32 or 64) wide. magic() handles
+   signed divisors 2 <= |d| < 2^(bits-1), and magicu() unsigned d >= 2;
+   the latter sets 'add' when the multiplier needs bits+1 bits. */
+
+static long
+magic(long d, int bits, int * shift)
+{
+    unsigned long two = 1UL << (bits - 1);
+    unsigned long ad, anc, t, q1, r1, q2, r2, delta;
+    int           p;
+
+    ad = (d < 0) ? -d : d;
+    t = two + (d < 0);
+    anc = t - 1 - t % ad;
+    p = bits - 1;
+    q1 = two / anc; r1 = two - q1 * anc;
+    q2 = two / ad; r2 = two - q2 * ad;
+
+    do {
+        p++;
+        q1 <<= 1; r1 <<= 1;
+        if (r1 >= anc) { q1++; r1 -= anc; }
+        q2 <<= 1; r2 <<= 1;
+        if (r2 >= ad) { q2++; r2 -= ad; }
+        delta = ad - r2;
+    } while ((q1 < delta) || ((q1 == delta) && (r1 == 0)));
+
+    *shift = p - bits;
+    q2++;
+    if (d < 0) q2 = -q2;
+    return (bits == 32) ? (long) (int) q2 : (long) q2;
+}
+
+static unsigned long
+magicu(unsigned long d, int bits, int * shift, int * add)
+{
+    unsigned long mask = (bits == 32) ? 0xFFFFFFFFUL : ~0UL;
+    unsigned long two = 1UL << (bits - 1);
+    unsigned long nc, q1, r1, q2, r2;
+    int           p;
+
+    *add = 0;
+    nc = mask - (mask - d + 1) % d;
+    p = bits - 1;
+    q1 = two / nc; r1 = two - q1 * nc;
+    q2 = (two - 1) / d; r2 = (two - 1) - q2 * d;
+
+    do {
+        p++;
+
+        if (r1 >= nc - r1) {
+            q1 = 2 * q1 + 1; r1 = 2 * r1 - nc;
+        } else {
+            q1 = 2 * q1; r1 = 2 * r1;
+        }
+
+        if (r2 + 1 >= d - r2) {
+            if (q2 >= two - 1) *add = 1;
+            q2 = 2 * q2 + 1; r2 = 2 * r2 + 1 - d;
+        } else {
+            if (q2 >= two) *add = 1;
+            q2 = 2 * q2; r2 = 2 * r2 + 1;
+        }
+
+        q1 &= mask; r1 &= mask; q2 &= mask; r2 &= mask;
+    } while ((p < 2 * bits) && ((q1 < d - 1 - r2) || ((q1 == d - 1 - r2) && (r1 == 0))));
+
+    *shift = p - bits;
+    return (q2 + 1) & mask;
+}
+
+/* divide 'left' by the constant 'right' with a multiply-high sequence,
+   leaving the quotient in a new temporary, which is returned. signed
+   powers of two get a shift instead. returns NULL, having done nothing,
+   if the operation isn't an int or long, or the divisor is unsuitable. */
+
+static struct tree *
+divcon(struct tree * left, struct tree * right)
+{
+    struct tree * q;
+    struct tree * t;
+    long          d;
+    long          m;
+    int           bits;
+    int           shift;
+    int           add;
+    int           ts;
+
+    if ((right->op != E_CON) || !(left->type->ts & (T_IS_INT | T_IS_LONG))) return NULL;
+
+    bits = (left->type->ts & T_IS_LONG) ? 64 : 32;
+    ts = (bits == 32) ? T_UINT : T_ULONG;
+    d = right->u.con.i;
+    q = temporary(copy_type(left->type));
+
+    if (left->type->ts & T_IS_SIGNED) {
+        if (bits == 32) d = (int) d;
+        if ((d < 2) && (d > -2)) goto none;
+        if (d == ((bits == 32) ? INT_MIN : LONG_MIN)) goto none;
+
+        if (!(d & (d - 1))) {
+            for (shift = 0; (1L << shift) < d; shift++) ;
+            choose(E_ASSIGN, copy_tree(q), copy_tree(left));
+            if (shift > 1) choose(E_SHR, copy_tree(q), int_tree(T_INT, (long) shift - 1));
+            choose(E_SHR, reg_tree(q->u.reg, new_type(ts)), int_tree(T_INT, (long) bits - shift));
+            choose(E_ADD, copy_tree(q), copy_tree(left));
+            choose(E_SHR, copy_tree(q), int_tree(T_INT, (long) shift));
+            return q;
+        }
+
+        m = magic(d, bits, &shift);
+        choose(E_ASSIGN, reg_tree(R_AX, copy_type(left->type)), copy_tree(left));
+        emit(new_insn(I_IMUL1, load(int_tree(left->type->ts & T_BASE, m))));
+        choose(E_ASSIGN, copy_tree(q), reg_tree(R_DX, copy_type(left->type)));
+        if ((d > 0) && (m < 0)) choose(E_ADD, copy_tree(q), copy_tree(left));
+        if ((d < 0) && (m > 0)) choose(E_SUB, copy_tree(q), copy_tree(left));
+        if (shift) choose(E_SHR, copy_tree(q), int_tree(T_INT, (long) shift));
+        t = temporary(new_type(ts));
+        choose(E_ASSIGN, copy_tree(t), copy_tree(q));
+        choose(E_SHR, copy_tree(t), int_tree(T_INT, (long) bits - 1));
+        choose(E_ADD, copy_tree(q), t);
+    } else {
+        if (bits == 32) d &= 0xFFFFFFFFL;
+        if ((d >= 0) && (d < 2)) goto none;
+
+        m = magicu(d, bits, &shift, &add);
+        choose(E_ASSIGN, reg_tree(R_AX, copy_type(left->type)), copy_tree(left));
+        emit(new_insn(I_MUL, load(int_tree(left->type->ts & T_BASE, m))));
+        choose(E_ASSIGN, copy_tree(q), reg_tree(R_DX, copy_type(left->type)));
+
+        if (add) {
+            t = temporary(copy_type(left->type));
+            choose(E_ASSIGN, copy_tree(t), copy_tree(left));
+            choose(E_SUB, copy_tree(t), copy_tree(q));
+            choose(E_SHR, copy_tree(t), int_tree(T_INT, 1L));
+            choose(E_ADD, copy_tree(q), t);
+            shift--;
+        }
+
+        if (shift) choose(E_SHR, copy_tree(q), int_tree(T_INT, (long) shift));
+    }
+
+    return q;
+
+none:
+    free_tree(q);
+    return NULL;
+}
+
 /* the AMD64 integer division instructions differ enough from the others
    that they require special handling. call this with 'op' = E_DIV or E_MOD.
    the returned tree will be the left tree. 'right' is yielded by the caller.
@@ -1165,6 +1552,7 @@ divmod(int op, struct tree * left, struct tree * right, int * result_cc)
 {
     struct tree * r_ax;
     struct tree * r_dx;
+    struct tree * q;
 
     if ((op == E_MOD) && (left->type->ts & (T_IS_UNSIGNED | T_PTR)) && log_2(right, 1)) {
         choose(E_AND, copy_tree(left), right);
@@ -1178,6 +1566,19 @@ divmod(int op, struct tree * left, struct tree * right, int * result_cc)
         return left;
     }
 
+    if (q = divcon(left, right)) {
+        if (op == E_MOD) {
+            if ((right->u.con.i < INT_MIN) || (right->u.con.i > INT_MAX)) right = load(right);
+            choose(E_MUL, copy_tree(q), right);
+            choose(E_SUB, copy_tree(left), q);
+        } else {
+            choose(E_ASSIGN, copy_tree(left), q);
+            free_tree(right);
+        }
+
+        return left;
+    }
+
     if ((right->op != E_REG) && (right->op != E_MEM)) right = load(right);
 
     if (left->type->ts & T_IS_CHAR) {
@@ -1748,3 +2149,22 @@ generate(struct tree * tree, int goal, int * cc)
     default: error(ERROR_INTERNAL);
     }
 }
+
+/* generate the E_ASSIGN 'tree', which initializes its left side: either
+   a new automatic struct or union (see initializer()), or the function's
+   own return value (see return_statement()). either way, nothing can see
+   the object yet, so a call can construct its result there directly. */
+
+void
+generate_init(struct tree * tree)
+{
+    struct tree * left;
+    struct tree * right;
+
+    if ((tree->type->ts & T_TAG) && (tree->u.ch[1]->op == E_CALL)) {
+        decap_tree(tree, NULL, &left, &right, NULL);
+        left = generate(left, GOAL_VALUE, NULL);
+        call(right, left, GOAL_EFFECT, NULL);
+    } else
+        generate(tree, GOAL_EFFECT, NULL);
+}
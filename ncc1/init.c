@@ -306,6 +306,13 @@ initializer(struct symbol * symbol, int ss)
                 tree = symbol_tree(symbol);
                 tree = assignment_expression(tree, ASSIGNMENT_CONST);
                 generate(tree, GOAL_EFFECT, NULL);
+            } else if ((symbol->type->ts & T_TAG) && !braced) {
+                /* an automatic struct or union can be initialized
+                   by an expression of its type, like a call. */
+
+                tree = symbol_tree(symbol);
+                tree = assignment_expression(tree, ASSIGNMENT_CONST);
+                generate_init(tree);
             } else if (symbol->type->ts & (T_TAG | T_ARRAY)) {
                 temp = new_symbol(NULL, S_STATIC, copy_type(symbol->type));
                 put_symbol(temp, SCOPE_RETIRED);
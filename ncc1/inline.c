@@ -0,0 +1,300 @@
+/* Copyright (c) 2018 Charles E. Youse (charles@gnuless.org). 
+   All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ncc1.h"
+
+/* inlining of small static functions. the front end generates code as
+   it parses, so there's no statement-level IR to speak of. instead, a 
+   function whose body is a single 'return <expression>;' is remembered
+   by the tree for that expression, and generate_call() substitutes it 
+   for calls that follow, with the arguments bound to the parameters.
+
+   the function is compiled as usual, but its output is diverted to a
+   temporary file, and only copied into the output at the end of the
+   translation unit if something still refers to it (S_NEEDED). since 
+   calls disqualify a tree, an inlined body never contains a call to
+   itself, and there's no danger of unbounded recursion. */
+
+struct callee
+{
+    struct symbol * function;
+    struct tree   * tree;           /* E_ASSIGN to the return register */
+    int             modified;       /* bitmask: parameters assigned to */
+    FILE          * text;           /* the diverted out-of-line copy */
+    struct callee * link;
+};
+
+static struct callee * inlines;
+static struct tree   * candidate;   /* captured from return_statement() */
+static int             modified;    /* ... and its parameters assigned to */
+static struct block  * start;       /* first block of function body */
+
+int inline_limit = INLINE_LIMIT;    /* -i: maximum size, in tree nodes */
+
+/* called by function_definition() before the body is parsed, to 
+   decide if the function is a possible candidate for inlining. */
+
+void
+inline_begin(int prototyped)
+{
+    struct symbol * arg;
+
+    candidate = NULL;
+    start = NULL;
+
+    if (!O_flag || (inline_limit <= 0) || !prototyped) return;
+    if (!(current_function->ss & S_STATIC)) return;
+    if (current_function->type->proto->ps & P_VARIADIC) return;
+    if (!(current_function->type->next->ts & T_IS_SCALAR)) return;
+
+    for (arg = current_function->type->proto->args; arg; arg = arg->list)
+        if (arg->type->ts & T_TAG) return;
+
+    start = current_block;
+}
+
+/* walk the expression tree, counting nodes, to see if it qualifies. 
+   references to parameters are redirected to the prototype arguments,
+   which live as long as the function does. returns the size of the
+   tree, or -1 if it can't be inlined. */
+
+static int
+walk(struct tree * tree, int * modified)
+{
+    struct symbol * arg;
+    int             size = 1;
+    int             n;
+    int             i;
+
+    if (tree == NULL) return 0;
+
+    switch (tree->op)
+    {
+    case E_CON:
+        return 1;
+
+    case E_SYM:
+        if (tree->u.sym->scope == SCOPE_GLOBAL) return 1;
+
+        for (n = 0, arg = current_function->type->proto->args; arg; ++n, arg = arg->list) 
+            if (find_symbol(arg->id, S_NORMAL, SCOPE_FUNCTION, SCOPE_FUNCTION) == tree->u.sym) {
+                if (n >= (sizeof(int) * 8)) return -1;
+                if (tree->u.sym->ss & S_AUTO) return -1;    /* address taken */
+                tree->u.sym = arg;
+                return 1;
+            }
+
+        return -1;
+
+    case E_CALL:
+        return -1;
+
+    case E_ASSIGN:
+    case E_PRE:
+    case E_POST:
+    case E_ADDASS: case E_SUBASS: case E_MULASS: case E_DIVASS: case E_MODASS:
+    case E_SHLASS: case E_SHRASS: case E_ANDASS: case E_ORASS:  case E_XORASS:
+        if (tree->u.ch[0]->op == E_SYM) 
+            for (n = 0, arg = current_function->type->proto->args; arg; ++n, arg = arg->list) 
+                if (find_symbol(arg->id, S_NORMAL, SCOPE_FUNCTION, SCOPE_FUNCTION) == tree->u.ch[0]->u.sym)
+                    if (n < (sizeof(int) * 8)) *modified |= 1 << n;
+        break;
+    }
+
+    if (E_IS_LEAF(tree->op)) return -1;
+
+    for (i = 0; i < NR_TREE_CH; ++i) {
+        n = walk(tree->u.ch[i], modified);
+        if (n < 0) return -1;
+        size += n;
+    }
+
+    return size;
+}
+
+/* called by return_statement() with the return assignment, before it's
+   generated. it's a candidate only if nothing precedes it in the body:
+   the front end only emits code for an expression when it contains a 
+   call (for the arguments), and calls disqualify the tree anyway. */
+
+void
+inline_return(struct tree * tree)
+{
+    int size;
+
+    if (start && (current_block == start) && (start->first_insn == NULL) && !candidate) {
+        candidate = copy_tree(tree);
+        modified = 0;
+        size = walk(candidate->u.ch[1], &modified);
+        if ((size > 0) && (size <= inline_limit)) return;
+    }
+
+    start = NULL;
+}
+
+/* called by function_definition() after the body is parsed. if the 
+   function is inlinable, it is remembered, and a FILE is returned 
+   to which its output should be diverted. otherwise returns NULL. */
+
+FILE *
+inline_end(void)
+{
+    struct callee * inl;
+
+    if (    candidate && start && (current_block != start) 
+        &&  (current_block->first_insn == NULL) && (current_block->nr_predecessors == 0) )
+    {
+        inl = allocate(sizeof(struct callee));
+        inl->function = current_function;
+        inl->tree = candidate;
+        inl->modified = modified;
+        inl->text = tmpfile();
+        if (inl->text == NULL) error(ERROR_OUTPUT);
+        inl->link = inlines;
+        inlines = inl;
+        candidate = NULL;
+        return inl->text;
+    }
+
+    free_tree(candidate);
+    candidate = NULL;
+    return NULL;
+}
+
+/* substitute the leaf 'arg' for the parameter references in 'tree'. 
+   the references keep the parameter's type: 'arg' is the same size, 
+   but it may be of different signedness. */
+
+static void
+substitute(struct tree * tree, struct symbol * param, struct tree * arg)
+{
+    int i;
+
+    if (tree == NULL) return;
+
+    if ((tree->op == E_SYM) && (tree->u.sym == param)) {
+        tree->op = arg->op;
+        memcpy(&tree->u, &arg->u, sizeof(tree->u));
+        return;
+    }
+
+    if (!E_IS_LEAF(tree->op)) 
+        for (i = 0; i < NR_TREE_CH; ++i) 
+            substitute(tree->u.ch[i], param, arg);
+}
+
+/* called by generate_call() with the (not yet generated) function and 
+   the (generated) arguments, in reverse order. if the function can be
+   inlined, returns the tree to generate in place of the call, which
+   assigns the result to a temporary. the caller retains ownership of
+   'function' and 'arguments'. otherwise returns NULL. */
+
+struct tree *
+inline_call(struct tree * function, struct tree * arguments)
+{
+    struct callee * inl;
+    struct symbol * param;
+    struct symbol * symbol;
+    struct tree   * tree;
+    struct tree   * arg;
+    struct tree   * temp;
+    int             nr_arguments = 0;
+    int             direct;
+    int             n;
+    int             i;
+
+    if (function->op != E_ADDR) return NULL;
+    function = function->u.ch[0];
+    if (function->op != E_SYM) return NULL;
+
+    for (inl = inlines; inl; inl = inl->link) 
+        if (inl->function == function->u.sym) break;
+
+    if (inl == NULL) return NULL;
+    for (arg = arguments; arg; arg = arg->list) ++nr_arguments;
+    for (param = inl->function->type->proto->args; param; param = param->list) --nr_arguments;
+    if (nr_arguments) return NULL;
+    for (arg = arguments; arg; arg = arg->list) ++nr_arguments;
+
+    tree = copy_tree(inl->tree);
+    free_tree(tree->u.ch[0]);
+    tree->u.ch[0] = temporary(copy_type(tree->type));
+
+    /* constants and unaliased registers (which the body can't touch) 
+       are substituted directly for parameters that aren't modified; 
+       anything else is first copied to a temporary. locals aren't
+       S_REGISTER until the end of the function, since their address
+       might yet be taken, so only temporaries qualify here. */
+
+    for (n = 0, param = inl->function->type->proto->args; param; ++n, param = param->list) {
+        for (arg = arguments, i = nr_arguments - 1 - n; i; --i) arg = arg->list;
+
+        if (arg->op == E_REG) {
+            symbol = find_symbol_by_reg(arg->u.reg);
+            direct = symbol && (symbol->ss & S_REGISTER);
+        } else
+            direct = (arg->op == E_CON);
+
+        if (    direct && !(inl->modified & (1 << n))
+            &&  (size_of(arg->type) == size_of(param->type)) )
+            substitute(tree->u.ch[1], param, arg);
+        else {
+            temp = temporary(copy_type(param->type));
+            choose(E_ASSIGN, copy_tree(temp), copy_tree(arg));
+            substitute(tree->u.ch[1], param, temp);
+            free_tree(temp);
+        }
+    }
+
+    ++stats[STAT_INLINE];
+    return tree;
+}
+
+/* called at the end of the translation unit to output
+   the out-of-line copies of functions that need them. */
+
+void
+output_inlines(void)
+{
+    struct callee * inl;
+    int             c;
+
+    while (inl = inlines) {
+        inlines = inl->link;
+
+        if (inl->function->ss & S_NEEDED) {
+            rewind(inl->text);
+            while ((c = getc(inl->text)) != EOF) putc(c, output_file);
+            divert(output_file);
+        }
+
+        fclose(inl->text);
+        free_tree(inl->tree);
+        free(inl);
+    }
+}
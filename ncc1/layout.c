@@ -0,0 +1,307 @@
+/* Copyright (c) 2018 Charles E. Youse (charles@gnuless.org). 
+   All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#include <stdlib.h>
+#include "ncc1.h"
+
+/* block layout. output_function() emits a jump wherever a block's 
+   successor isn't the next block, so the order of blocks determines 
+   which branches are taken. this pass orders the blocks in the manner 
+   of Pettis and Hansen: each edge in the flow graph is given a weight,
+   the blocks are linked into chains along the heaviest edges, and the 
+   chains are then placed so that the heaviest edges between them are
+   forward edges. cold blocks are placed last.
+
+   absent a profile, the weights are estimates. each loop level is taken
+   to multiply a block's frequency by 8; a conditional branch is assumed
+   to stay in the loop 7 times out of 8, and to avoid a 'cold' successor
+   (a block with a single predecessor that makes a call, usually to 
+   report an error) 15 times out of 16. the back edge of a loop is 
+   preferred to the edge from the header, which places the body first 
+   and the test at the bottom.
+
+   a profile (ncc1 -p) contains lines of the form
+
+        <function> <from> <to> <count>
+
+   giving the number of times the edge between two blocks was taken. 
+   blocks are identified by their labels, as given in -g output. if
+   the profile has any entries for the function, the estimates are not 
+   used at all: edges that don't appear are assumed never taken. */
+
+struct profile
+{
+    char           * function;
+    int              from;
+    int              to;
+    long             count;
+    struct profile * link;
+};
+
+static struct profile * profiles;
+
+struct edge
+{
+    struct block * from;
+    struct block * to;
+    long           weight;
+    int            back;        /* back edge? */
+    int            n;           /* for a stable sort */
+};
+
+/* read the profile at 'path'. called once, at startup. */
+
+void
+read_profile(char * path)
+{
+    struct profile * profile;
+    char             function[256];
+    FILE           * fp;
+    int              from;
+    int              to;
+    long             count;
+    int              n;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) error(ERROR_PROFILE);
+
+    while ((n = fscanf(fp, "%255s %d %d %ld", function, &from, &to, &count)) == 4) {
+        profile = allocate(sizeof(struct profile));
+        profile->function = allocate(strlen(function) + 1);
+        strcpy(profile->function, function);
+        profile->from = from;
+        profile->to = to;
+        profile->count = count;
+        profile->link = profiles;
+        profiles = profile;
+    }
+
+    if (n != EOF) error(ERROR_PROFILE);
+    fclose(fp);
+}
+
+static int
+profiled(void)
+{
+    struct profile * profile;
+
+    for (profile = profiles; profile; profile = profile->link) 
+        if (!strcmp(profile->function, current_function->id->data)) return 1;
+
+    return 0;
+}
+
+static long
+profile_weight(struct block * from, struct block * to)
+{
+    struct profile * profile;
+
+    for (profile = profiles; profile; profile = profile->link) 
+        if (    (profile->from == from->asm_label) && (profile->to == to->asm_label) 
+            &&  !strcmp(profile->function, current_function->id->data)  )
+        {
+            return profile->count;
+        }
+
+    return 0;
+}
+
+static int
+cold(struct block * block)
+{
+    struct insn * insn;
+
+    if (block->nr_predecessors != 1) return 0;
+    if (block->loop && (block->loop->header == block)) return 0;
+
+    for (insn = block->first_insn; insn; insn = insn->next)
+        if (insn->opcode == I_CALL) return 1;
+
+    return 0;
+}
+
+static long
+estimate_weight(struct block * from, int n)
+{
+    struct block * to = block_successor(from, n);
+    struct block * other;
+    long           weight;
+    int            level;
+
+    level = from->loop ? from->loop->depth : 0;
+    if (level > 6) level = 6;
+    weight = 1L << (3 * level + 4);
+    if (cold(from)) weight /= 16;
+    if (from->nr_successors != 2) return weight / from->nr_successors;
+    other = block_successor(from, !n);
+
+    if (cold(to) != cold(other)) 
+        return cold(to) ? (weight / 16) : (weight - weight / 16);
+
+    if (from->loop && (in_loop(to, from->loop) != in_loop(other, from->loop)))
+        return in_loop(to, from->loop) ? (weight - weight / 8) : (weight / 8);
+
+    return weight / 2;
+}
+
+static int
+edge_cmp(const void * v1, const void * v2)
+{
+    const struct edge * e1 = v1;
+    const struct edge * e2 = v2;
+
+    if (e1->weight != e2->weight) return (e1->weight > e2->weight) ? -1 : 1;
+    if (e1->back != e2->back) return e2->back - e1->back;
+    return e1->n - e2->n;
+}
+
+/* the chains are kept in arrays indexed by block->rpo */
+
+static struct block ** blocks;
+static int           * heads;       /* head of the chain containing block */
+static int           * nexts;       /* next block in chain (or -1) */
+static int           * tails;       /* for heads only: last in chain */
+
+void
+layout_blocks(void)
+{
+    struct block * block;
+    struct block * successor;
+    struct block * unreachable;
+    struct edge  * edges;
+    long           connection;
+    long           best_connection;
+    int            best_cold;
+    int            use_profile;
+    int            nr_blocks = 0;
+    int            nr_edges = 0;
+    int            best;
+    int            head;
+    int            i;
+    int            n;
+
+    find_loops();
+    use_profile = profiled();
+
+    for (block = first_block; block; block = block->next) {
+        if (block->rpo < 0) continue;
+        ++nr_blocks;
+        nr_edges += block->nr_successors;
+    }
+
+    blocks = allocate(nr_blocks * sizeof(*blocks));
+    heads = allocate(nr_blocks * sizeof(*heads));
+    nexts = allocate(nr_blocks * sizeof(*nexts));
+    tails = allocate(nr_blocks * sizeof(*tails));
+    edges = allocate((nr_edges + 1) * sizeof(*edges));
+
+    for (nr_edges = 0, block = first_block; block; block = block->next) {
+        if (block->rpo < 0) continue;
+        blocks[block->rpo] = block;
+        heads[block->rpo] = block->rpo;
+        tails[block->rpo] = block->rpo;
+        nexts[block->rpo] = -1;
+
+        if (block->table) continue;     /* jump tables can't fall through */
+
+        for (n = 0; successor = block_successor(block, n); ++n) {
+            if ((successor == entry_block) || (successor == block)) continue;
+            edges[nr_edges].from = block;
+            edges[nr_edges].to = successor;
+            edges[nr_edges].back = dominates(successor, block);
+            edges[nr_edges].n = nr_edges;
+
+            if (use_profile) 
+                edges[nr_edges].weight = profile_weight(block, successor);
+            else
+                edges[nr_edges].weight = estimate_weight(block, n);
+
+            ++nr_edges;
+        }
+    }
+
+    /* form the chains. an edge joins two chains if it
+       leads from the tail of one to the head of another. */
+
+    qsort(edges, nr_edges, sizeof(*edges), edge_cmp);
+
+    for (i = 0; i < nr_edges; ++i) {
+        if (edges[i].weight <= 0) break;
+        head = heads[edges[i].from->rpo];
+        if (tails[head] != edges[i].from->rpo) continue;
+        if (heads[edges[i].to->rpo] != edges[i].to->rpo) continue;
+        if (head == edges[i].to->rpo) continue;
+
+        nexts[edges[i].from->rpo] = edges[i].to->rpo;
+        tails[head] = tails[edges[i].to->rpo];
+        for (n = edges[i].to->rpo; n >= 0; n = nexts[n]) heads[n] = head;
+    }
+
+    /* place the chains, starting with the entry block's. the next chain
+       is the one most heavily connected to those already placed; cold
+       chains go last, and ties go to the earliest in reverse postorder.
+       unreachable blocks aren't moved, so they end up after the rest. */
+
+    for (n = 0; n < nr_blocks; ++n) get_block(blocks[n]);
+    unreachable = first_block;
+    head = entry_block->rpo;
+
+    while (head >= 0) {
+        for (n = head; n >= 0; n = nexts[n]) {
+            put_block(blocks[n], unreachable);
+            heads[n] = -1;
+        }
+
+        best = -1;
+        best_cold = 1;
+        best_connection = -1;
+
+        for (n = 0; n < nr_blocks; ++n) {
+            if (heads[n] != n) continue;
+
+            for (connection = 0, i = 0; i < nr_edges; ++i) 
+                if ((heads[edges[i].from->rpo] < 0) && (heads[edges[i].to->rpo] == n))
+                    if (edges[i].weight > connection) connection = edges[i].weight;
+
+            if (    (best < 0) 
+                ||  (cold(blocks[n]) < best_cold)
+                ||  ((cold(blocks[n]) == best_cold) && (connection > best_connection)) )
+            {
+                best = n;
+                best_cold = cold(blocks[n]);
+                best_connection = connection;
+            }
+        }
+
+        head = best;
+    }
+
+    free(blocks);
+    free(heads);
+    free(nexts);
+    free(tails);
+    free(edges);
+    free_loops();
+}
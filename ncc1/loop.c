@@ -0,0 +1,1529 @@
+/* Copyright (c) 2018 Charles E. Youse (charles@gnuless.org). 
+   All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#include <stdlib.h>
+#include <limits.h>
+#include "ncc1.h"
+
+/* the loop forest. find_loops() computes the dominator tree, then finds
+   the natural loops: a back edge is an edge to a block that dominates its 
+   source, and its loop is the header plus every block that can reach the
+   source without passing through the header. back edges sharing a header 
+   are merged into one loop. as a side effect, each block's loop_level is
+   replaced by its depth in the forest, which is more accurate than the 
+   lexical depth recorded by the parser. (unreachable blocks are ignored.) */
+
+struct loop * loops;    /* inner loops always precede outer ones */
+
+/* the dominator computation is the simple iterative algorithm of Cooper,
+   Harvey and Kennedy, which relies on the block list being in reverse 
+   postorder, as sequence_blocks() leaves it. */
+
+static struct block *
+intersect(struct block * block1, struct block * block2)
+{
+    while (block1 != block2) {
+        while (block1->rpo > block2->rpo) block1 = block1->idom;
+        while (block2->rpo > block1->rpo) block2 = block2->idom;
+    }
+
+    return block1;
+}
+
+static void
+dominators(void)
+{
+    struct block * block;
+    struct block * predecessor;
+    struct block * idom;
+    int            changes;
+    int            rpo;
+    int            n;
+
+    sequence_blocks();
+
+    for (rpo = 0, block = first_block; block; block = block->next) {
+        block->idom = NULL;
+        block->loop = NULL;
+        block->rpo = (block->bs & B_SEQ) ? rpo++ : -1;
+    }
+
+    first_block->idom = first_block;
+
+    do {
+        changes = 0;
+
+        for (block = first_block->next; block && (block->rpo >= 0); block = block->next) {
+            idom = NULL;
+
+            for (n = 0; predecessor = block_predecessor(block, n); ++n) {
+                if (predecessor->idom == NULL) continue;
+                idom = idom ? intersect(predecessor, idom) : predecessor;
+            }
+
+            if (block->idom != idom) {
+                block->idom = idom;
+                ++changes;
+            }
+        }
+    } while (changes);
+}
+
+/* does 'block1' dominate 'block2'? */
+
+int
+dominates(struct block * block1, struct block * block2)
+{
+    for (;;) {
+        if (block2 == block1) return 1;
+        if ((block2->idom == NULL) || (block2->idom == block2)) return 0;
+        block2 = block2->idom;
+    }
+}
+
+/* is 'block' in 'loop' (or one of its inner loops)? */
+
+int
+in_loop(struct block * block, struct loop * loop)
+{
+    struct loop * inner;
+
+    for (inner = block->loop; inner; inner = inner->parent)
+        if (inner == loop) return 1;
+
+    return 0;
+}
+
+/* add 'block' (which reaches a back edge of 'loop') to the body of 'loop'.
+   a block already claimed by an inner loop brings that whole loop with it. */
+
+static void
+natural_loop(struct loop * loop, struct block * block)
+{
+    struct block * predecessor;
+    struct loop  * inner;
+    int            n;
+
+    if (block->rpo < 0) return;
+
+    if (block->loop == NULL) {
+        block->loop = loop;
+
+        for (n = 0; predecessor = block_predecessor(block, n); ++n)
+            natural_loop(loop, predecessor);
+    } else {
+        for (inner = block->loop; inner->parent; inner = inner->parent) ;
+        if (inner == loop) return;
+        inner->parent = loop;
+
+        for (n = 0; predecessor = block_predecessor(inner->header, n); ++n)
+            natural_loop(loop, predecessor);
+    }
+}
+
+void
+free_loops(void)
+{
+    struct loop * loop;
+
+    while (loop = loops) {
+        loops = loop->next;
+        free(loop);
+    }
+}
+
+void
+find_loops(void)
+{
+    struct block * header;
+    struct block * predecessor;
+    struct block * block;
+    struct loop  * loop;
+    struct loop ** tail;
+    struct loop  * outer;
+    int            n;
+
+    free_loops();
+    dominators();
+    tail = &loops;
+
+    /* an inner loop's header is dominated by the outer loop's header, so 
+       it comes later in reverse postorder: working backwards through the
+       blocks ensures inner loops are found first, as natural_loop() needs. */
+
+    for (header = last_block; header; header = header->previous) {
+        if (header->rpo < 0) continue;
+        loop = NULL;
+
+        for (n = 0; predecessor = block_predecessor(header, n); ++n) {
+            if (predecessor->rpo < 0) continue;
+            if (!dominates(header, predecessor)) continue;
+
+            if (loop == NULL) {
+                loop = allocate(sizeof(struct loop));
+                loop->header = header;
+                loop->parent = NULL;
+                loop->next = NULL;
+                header->loop = loop;
+                *tail = loop;
+                tail = &loop->next;
+            }
+
+            natural_loop(loop, predecessor);
+        }
+    }
+
+    for (loop = loops; loop; loop = loop->next) 
+        for (loop->depth = 0, outer = loop; outer; outer = outer->parent)
+            ++loop->depth;
+
+    for (block = first_block; block; block = block->next)
+        block->loop_level = block->loop ? block->loop->depth : 0;
+}
+
+/* loop-invariant code motion. an instruction can be hoisted out of a loop 
+   into its preheader if it computes a value that doesn't change from one 
+   iteration to the next, and executing it when the original wouldn't have
+   been executed is harmless. in practice, in the ncc1 IR, this means the
+   instructions that compute a temporary from invariant operands, which
+   are often several insns long (MOV T, I / IMUL T, 8 / ADD T, B). such a
+   "chain" of DEFs is hoisted as a unit, under these conditions:
+
+   1. the register is an S_REGISTER pseudo, DEFd only by the chain (which 
+      must begin with a pure DEF, and be uninterrupted by other USEs),
+   2. it isn't live into the loop header, so every use in the loop sees
+      the value computed by the chain in the same iteration,
+   3. every other register USEd by the chain is invariant (is the frame 
+      pointer, or a pseudo not DEFd in the loop; aliased variables also
+      require that the loop not write memory),
+   4. the chain's insns have no side effects, don't DEF any other registers,
+      and don't set condition codes that anyone's looking at,
+   5. memory is only read if the loop doesn't write memory (or make calls),
+      and only at fixed addresses (static or frame) that can't fault. */
+
+static int
+nr_defs(struct loop * loop, int reg)
+{
+    struct block * block;
+    struct insn  * insn;
+    int            n = 0;
+
+    for (block = first_block; block; block = block->next) 
+        if (in_loop(block, loop)) 
+            for (insn = block->first_insn; insn; insn = insn->next)
+                if (insn_defs_reg(insn, reg)) ++n;
+
+    return n;
+}
+
+static int
+invariant(struct loop * loop, int reg, int stores)
+{
+    struct symbol * symbol;
+
+    if (reg == R_BP) return 1;
+    if (!R_IS_PSEUDO(reg)) return 0;
+    symbol = find_symbol_by_reg(reg);
+    if (!(symbol->ss & S_REGISTER) && stores) return 0;
+    return (nr_defs(loop, reg) == 0);
+}
+
+static int
+hoistable(struct loop * loop, struct insn * insn, int reg, int stores)
+{
+    struct tree * operand;
+    int           i;
+
+    if (insn->opcode & (I_USE_CC | I_STRING)) return 0;
+    if (insn->flags & INSN_FLAG_CC) return 0;
+    if (insn->mem_defd) return 0;
+    if (insn_nr_defs(insn) != 1) return 0;
+    if (!insn_defs_reg(insn, reg)) return 0;
+
+    for (i = 0; (i < NR_INSN_REGS) && (insn->regs_used[i] != R_NONE); ++i) 
+        if ((insn->regs_used[i] != reg) && !invariant(loop, insn->regs_used[i], stores)) 
+            return 0;
+
+    if ((insn->opcode != I_LEA) && insn->mem_used) {
+        if (stores) return 0;
+
+        for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+            operand = insn->operand[i];
+            if (operand->op != E_MEM) continue;
+            if (operand->type->ts & T_VOLATILE) return 0;
+            if ((operand->u.mi.b != R_NONE) && (operand->u.mi.b != R_BP)) return 0;
+            if (operand->u.mi.i != R_NONE) return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* return the preheader of the loop, creating it if necessary: the
+   sole block outside the loop which leads to the header, and only 
+   to the header. the entry block never qualifies (it's destined to
+   hold the function prologue, which must precede everything). */
+
+static struct block *
+preheader(struct loop * loop)
+{
+    struct block * header = loop->header;
+    struct block * predecessor;
+    struct block * outside = NULL;
+    struct block * block;
+    int            nr_outside = 0;
+    int            cc;
+    int            n;
+    int            i;
+
+    for (n = 0; predecessor = block_predecessor(header, n); ++n) {
+        if (!in_loop(predecessor, loop)) {
+            outside = predecessor;
+            ++nr_outside;
+        }
+    }
+
+    if ((nr_outside == 1) && (outside->nr_successors == 1) && (outside != entry_block)) 
+        return outside;
+
+    block = new_block();
+    block->loop = loop->parent;
+    block->loop_level = loop->depth - 1;
+
+  again:
+    for (n = 0; predecessor = block_predecessor(header, n); ++n) {
+        if ((predecessor == block) || in_loop(predecessor, loop)) continue;
+
+        for (i = 0; block_successor(predecessor, i) != header; ++i) ;
+        cc = block_successor_cc(predecessor, i);
+        unsucceed_block(predecessor, i);
+        succeed_block(predecessor, cc, block);
+        goto again;
+    }
+
+    succeed_block(block, CC_ALWAYS, header);
+    return block;
+}
+
+/* try to hoist the chain of DEFs beginning with 'first'. */
+
+static int
+hoist_chain(struct loop * loop, struct block * block, struct insn * first, int stores)
+{
+    struct defuse * defuse;
+    struct symbol * symbol;
+    struct block  * pre;
+    struct insn   * insn;
+    struct insn   * next;
+    int             reg;
+    int             nr;
+    int             n;
+
+    if (insn_nr_defs(first) != 1) return 0;
+    reg = first->regs_defd[0];
+    if (!R_IS_PSEUDO(reg)) return 0;
+    if (insn_uses_reg(first, reg)) return 0;
+    symbol = find_symbol_by_reg(reg);
+    if (!(symbol->ss & S_REGISTER)) return 0;
+    defuse = find_defuse(loop->header, reg, FIND_DEFUSE_NORMAL);
+    if (defuse && (defuse->dus & DU_IN)) return 0;
+
+    nr = nr_defs(loop, reg);
+
+    for (n = 0, insn = first; insn; insn = insn->next) {
+        if (!insn_touches_reg(insn, reg)) continue;
+        if (!insn_defs_reg(insn, reg)) return 0;
+        if (!hoistable(loop, insn, reg, stores)) return 0;
+        if (++n == nr) break;
+    }
+
+    if (insn == NULL) return 0;
+    pre = preheader(loop);
+
+    for (insn = first; insn; insn = next) {
+        next = insn->next;
+
+        if (insn_touches_reg(insn, reg)) {
+            get_insn(block, insn);
+            put_insn(pre, insn, NULL);
+            ++stats[STAT_LICM];
+            if (--n == 0) break;
+        }
+    }
+
+    return 1;
+}
+
+static int
+hoist(struct loop * loop)
+{
+    struct block * block;
+    struct insn  * insn;
+    int            stores = 0;
+    int            changes = 0;
+
+    if (loop->header == entry_block) return 0;
+
+    for (block = first_block; block; block = block->next) 
+        if (in_loop(block, loop)) 
+            for (insn = block->first_insn; insn; insn = insn->next)
+                if (insn->mem_defd) stores = 1;
+
+  again:
+    for (block = first_block; block; block = block->next) {
+        if (!in_loop(block, loop)) continue;
+
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            if (hoist_chain(loop, block, insn, stores)) {
+                ++changes;
+                goto again;
+            }
+        }
+    }
+
+    return changes;
+}
+
+/* called by optimize(), once the local optimizations have done what they 
+   can. returns non-zero if anything was hoisted. since the preheaders are
+   themselves inside any enclosing loops, after hoisting out of one loop 
+   everything is recomputed and the process is restarted. */
+
+int
+licm(void)
+{
+    struct loop * loop;
+    int           changes = 0;
+
+  again:
+    compute_global_defuses();
+    find_loops();
+
+    for (loop = loops; loop; loop = loop->next) {
+        if (hoist(loop)) {
+            ++changes;
+            goto again;
+        }
+    }
+
+    free_loops();
+    return changes;
+}
+
+/* induction variables. a basic induction variable J is an S_REGISTER pseudo
+   (a signed int or long) whose only DEF in the loop steps it by a constant.
+   array subscripting derives chains from J like
+
+        MOVSX T, J / IMUL T, 8 / ADD T, B
+
+   in which every other operand is a constant or invariant, so T = S*J + C 
+   for a constant S and an invariant C. such a chain is strength-reduced:
+   the same chain computes a new pseudo Q in the preheader, Q is bumped by
+   S*STEP immediately before J is, and the chain in the loop is replaced by 
+   a copy of Q. chains that compute the same thing share the same Q. apart
+   from the use of J, the conditions on the chain are those of LICM. */
+
+struct iv
+{
+    struct block * header;      /* header of the loop */
+    int            j;           /* the basic induction variable */
+    int            q;           /* the reduced pseudo, S*J + C */
+    long           s;
+    struct insn  * chain;       /* private copy of the chain computing Q */
+    int            nr_insns;    /* ... and its length */
+    struct iv    * link;
+};
+
+static struct iv * ivs;
+
+static void
+free_ivs(void)
+{
+    struct insn * insn;
+    struct iv   * iv;
+
+    while (iv = ivs) {
+        ivs = iv->link;
+
+        while (insn = iv->chain) {
+            iv->chain = insn->next;
+            free_insn(insn);
+        }
+
+        free(iv);
+    }
+}
+
+/* if 'j' is a basic induction variable in 'loop', return its DEF (and the
+   block it's in, and the step). otherwise, return NULL. */
+
+static struct insn *
+basic_iv(struct loop * loop, int j, struct block ** blockp, long * step)
+{
+    struct symbol * symbol;
+    struct block  * block;
+    struct insn   * insn;
+    struct insn   * def = NULL;
+
+    if (!R_IS_PSEUDO(j)) return NULL;
+    symbol = find_symbol_by_reg(j);
+    if (!(symbol->ss & S_REGISTER)) return NULL;
+    if (!(symbol->type->ts & (T_INT | T_LONG))) return NULL;
+
+    for (block = first_block; block; block = block->next) {
+        if (!in_loop(block, loop)) continue;
+
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            if (!insn_defs_reg(insn, j)) continue;
+            if (def) return NULL;
+            def = insn;
+            *blockp = block;
+        }
+    }
+
+    if ((def == NULL) || (insn_nr_defs(def) != 1)) return NULL;
+    if (def->operand[0]->op != E_REG) return NULL;
+
+    switch (def->opcode)
+    {
+    case I_INC:     *step = 1; break;
+    case I_DEC:     *step = -1; break;
+
+    case I_ADD:
+    case I_SUB:
+        if (def->operand[1]->op != E_CON) return NULL;
+        *step = def->operand[1]->u.con.i;
+        if (def->opcode == I_SUB) *step = -*step;
+        break;
+
+    default:        return NULL;
+    }
+
+    if ((*step > INT_MAX) || (*step < -INT_MAX)) return NULL;
+    return def;
+}
+
+/* examine 'insn', a link in a candidate chain for 't', and update 's', the
+   multiplier of J so far. J itself is identified when it's first seen. */
+
+static int
+affine(struct loop * loop, struct insn * insn, int t, int * j, long * s, int first, int stores)
+{
+    struct tree * src;
+    long          c;
+
+    if (insn->opcode & (I_USE_CC | I_STRING)) return 0;
+    if (insn->flags & INSN_FLAG_CC) return 0;
+    if (insn_nr_defs(insn) != 1) return 0;
+    if (I_NR_OPERANDS(insn->opcode) != 2) return 0;     /* e.g., NEG, NOT */
+    if ((insn->operand[0]->op != E_REG) || (insn->operand[0]->u.reg != t)) return 0;
+    src = insn->operand[1];
+
+    if (insn->opcode == I_LEA) {
+        if (!first) return 0;
+        if ((src->u.mi.b != R_NONE) && !invariant(loop, src->u.mi.b, stores)) return 0;
+        if ((src->u.mi.i != R_NONE) && !invariant(loop, src->u.mi.i, stores)) return 0;
+        return 1;
+    }
+
+    if (src->op == E_CON) {
+        c = src->u.con.i;
+
+        switch (insn->opcode)
+        {
+        case I_MOV:     return first;
+        case I_ADD:
+        case I_SUB:     return !first;
+        case I_IMUL:    break;
+
+        case I_SHL:     
+            if ((c < 0) || (c > 31)) return 0;
+            c = 1L << c;
+            break;
+
+        default:        return 0;
+        }
+
+        if (first || (c > INT_MAX) || (c < -INT_MAX)) return 0;
+        *s *= c;
+        return ((*s <= INT_MAX) && (*s >= -INT_MAX));
+    }
+
+    if (src->op != E_REG) return 0;
+
+    if (invariant(loop, src->u.reg, stores)) {
+        switch (insn->opcode)
+        {
+        case I_MOV:
+        case I_MOVSX:   return first;
+        case I_ADD:
+        case I_SUB:     return !first;
+        default:        return 0;
+        }
+    }
+
+    if (*j != R_NONE) return 0;
+    *j = src->u.reg;
+    *s = 1;
+
+    switch (insn->opcode)
+    {
+    case I_MOV:     return first && (src->type->ts & T_IS_QWORD);
+    case I_MOVSX:   return first && (src->type->ts & T_IS_DWORD);
+    case I_ADD:     return !first;
+    default:        return 0;
+    }
+}
+
+/* does the chain of 'nr_insns' DEFs of 't' beginning with 'insn'
+   compute the same thing as the chain recorded in 'iv'? */
+
+static int
+same_chain(struct iv * iv, struct insn * insn, int t, int nr_insns)
+{
+    struct insn * copy;
+    struct tree * operand;
+    int           i;
+
+    if (iv->nr_insns != nr_insns) return 0;
+
+    for (copy = iv->chain; copy; copy = copy->next, insn = insn->next) {
+        while (!insn_touches_reg(insn, t)) insn = insn->next;
+        if (copy->opcode != insn->opcode) return 0;
+
+        for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+            operand = insn->operand[i];
+
+            if ((operand->op == E_REG) && (operand->u.reg == t)) {
+                if (copy->operand[i]->op != E_REG) return 0;
+                if (copy->operand[i]->u.reg != iv->q) return 0;
+            } else if (!same_tree(operand, copy->operand[i]))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* try to reduce the chain of DEFs beginning with 'first'. */
+
+static int
+reduce_chain(struct loop * loop, struct block * block, struct insn * first, int stores)
+{
+    struct defuse * defuse;
+    struct symbol * symbol;
+    struct block  * def_block;
+    struct block  * pre;
+    struct insn   * last;
+    struct insn   * insn;
+    struct insn   * next;
+    struct insn   * copy;
+    struct insn  ** tail;
+    struct insn   * def;
+    struct iv     * iv;
+    long            step;
+    long            s = 0;
+    int             j = R_NONE;
+    int             t;
+    int             nr;
+    int             n;
+
+    if (insn_nr_defs(first) != 1) return 0;
+    t = first->regs_defd[0];
+    if (!R_IS_PSEUDO(t)) return 0;
+    if (insn_uses_reg(first, t)) return 0;
+    symbol = find_symbol_by_reg(t);
+    if (!(symbol->ss & S_REGISTER)) return 0;
+    if (!(symbol->type->ts & (T_IS_LONG | T_PTR))) return 0;
+    defuse = find_defuse(loop->header, t, FIND_DEFUSE_NORMAL);
+    if (defuse && (defuse->dus & DU_IN)) return 0;
+
+    nr = nr_defs(loop, t);
+    if (nr < 2) return 0;
+
+    for (n = 0, last = first; last; last = last->next) {
+        if (!insn_touches_reg(last, t)) continue;
+        if (!insn_defs_reg(last, t)) return 0;
+        if (!affine(loop, last, t, &j, &s, n == 0, stores)) return 0;
+        if (++n == nr) break;
+    }
+
+    if ((last == NULL) || (j == R_NONE) || (s == 0)) return 0;
+    def = basic_iv(loop, j, &def_block, &step);
+    if (def == NULL) return 0;
+
+    for (insn = first; insn != last; insn = insn->next)
+        if (insn == def) return 0;
+
+    for (iv = ivs; iv; iv = iv->link) 
+        if ((iv->header == loop->header) && (iv->j == j) && same_chain(iv, first, t, n))
+            break;
+
+    if (iv == NULL) {
+        iv = allocate(sizeof(struct iv));
+        iv->header = loop->header;
+        iv->j = j;
+        iv->q = symbol_reg(temporary_symbol(new_type(T_LONG)));
+        iv->s = s;
+        iv->nr_insns = n;
+        iv->chain = NULL;
+        iv->link = ivs;
+        ivs = iv;
+
+        pre = preheader(loop);
+        tail = &iv->chain;
+
+        for (insn = first; ; insn = insn->next) {
+            if (insn_touches_reg(insn, t)) {
+                copy = dup_insn(insn);
+                insn_replace_reg(copy, t, iv->q);
+                put_insn(pre, copy, NULL);
+                *tail = dup_insn(copy);
+                tail = &(*tail)->next;
+            }
+
+            if (insn == last) break;
+        }
+
+        insn = new_insn(I_ADD, reg_tree(iv->q, new_type(T_LONG)), int_tree(T_LONG, s * step));
+        put_insn(def_block, insn, def);
+    }
+
+    insn = new_insn(I_MOV, reg_tree(t, copy_type(symbol->type)), reg_tree(iv->q, new_type(T_LONG)));
+    put_insn(block, insn, last->next);
+
+    for (insn = first; ; insn = next) {
+        next = insn->next;
+        if (insn_touches_reg(insn, t)) kill_insn(block, insn);
+        if (insn == last) break;
+    }
+
+    ++stats[STAT_IV];
+    return 1;
+}
+
+/* linear-function test replacement. if J is only kept around to be compared
+   against a bound N (a constant or invariant), then compare Q against the 
+   same function of N instead, and J dies. S must be positive to preserve
+   the sense of the comparison. note that, when the chain folds a base into
+   the address (as ADD T, B above), the bound is computed as an offset from
+   that base, so Q need not be a pointer for this to apply. */
+
+static int
+replace_test(struct loop * loop, struct iv * iv, int stores)
+{
+    struct defuse * defuse;
+    struct block  * def_block;
+    struct block  * cmp_block;
+    struct block  * successor;
+    struct block  * block;
+    struct insn   * insn;
+    struct insn   * copy;
+    struct insn   * def;
+    struct insn   * cmp = NULL;
+    struct insn   * mov;
+    struct tree   * bound;
+    long            step;
+    long            c;
+    int             e;
+    int             i;
+    int             n;
+
+    if (iv->s <= 0) return 0;
+    def = basic_iv(loop, iv->j, &def_block, &step);
+    if ((def == NULL) || (def->flags & INSN_FLAG_CC)) return 0;
+
+    for (block = first_block; block; block = block->next) {
+        if (!in_loop(block, loop)) continue;
+
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            if ((insn == def) || !insn_uses_reg(insn, iv->j)) continue;
+            if (cmp) return 0;
+            cmp = insn;
+            cmp_block = block;
+        }
+
+        for (n = 0; successor = block_successor(block, n); ++n) {
+            if (in_loop(successor, loop)) continue;
+            defuse = find_defuse(successor, iv->j, FIND_DEFUSE_NORMAL);
+            if (defuse && (defuse->dus & DU_IN)) return 0;
+        }
+    }
+
+    if ((cmp == NULL) || (cmp->opcode != I_CMP)) return 0;
+    if (cmp != cmp_block->last_insn) return 0;
+
+    for (n = 0; n < cmp_block->nr_successors; ++n) 
+        if (block_successor_cc(cmp_block, n) > CC_L) return 0;
+
+    if ((cmp->operand[0]->op == E_REG) && (cmp->operand[0]->u.reg == iv->j))
+        i = 0;
+    else
+        i = 1;
+
+    bound = cmp->operand[!i];
+
+    if (bound->op == E_REG) {
+        if (!invariant(loop, bound->u.reg, stores)) return 0;
+    } else if (bound->op != E_CON)
+        return 0;
+
+    e = symbol_reg(temporary_symbol(new_type(T_LONG)));
+    block = preheader(loop);
+
+    /* when the bound is constant, the leading constant arithmetic
+       of the chain is folded into the initial MOV, as it's copied. */
+
+    for (mov = NULL, insn = iv->chain; insn; insn = insn->next) {
+        if (mov && (insn->operand[1]->op == E_CON)) {
+            c = insn->operand[1]->u.con.i;
+
+            switch (insn->opcode)
+            {
+            case I_ADD:     mov->operand[1]->u.con.i += c; continue;
+            case I_SUB:     mov->operand[1]->u.con.i -= c; continue;
+            case I_IMUL:    mov->operand[1]->u.con.i *= c; continue;
+            case I_SHL:     mov->operand[1]->u.con.i <<= c; continue;
+            }
+        }
+
+        copy = dup_insn(insn);
+        insn_replace_reg(copy, iv->q, e);
+
+        for (n = 0; n < I_NR_OPERANDS(copy->opcode); ++n) {
+            if ((copy->operand[n]->op != E_REG) || (copy->operand[n]->u.reg != iv->j)) continue;
+
+            if (bound->op == E_REG)
+                copy->operand[n]->u.reg = bound->u.reg;
+            else {
+                free_tree(copy->operand[n]);
+                copy->operand[n] = int_tree(T_LONG, bound->u.con.i);
+                if (copy->opcode == I_MOVSX) copy->opcode = I_MOV;
+            }
+        }
+
+        put_insn(block, copy, NULL);
+        mov = ((copy->opcode == I_MOV) && (copy->operand[1]->op == E_CON)) ? copy : NULL;
+    }
+
+    free_tree(cmp->operand[0]);
+    free_tree(cmp->operand[1]);
+    cmp->operand[i] = reg_tree(iv->q, new_type(T_LONG));
+    cmp->operand[!i] = reg_tree(e, new_type(T_LONG));
+    kill_insn(def_block, def);
+
+    ++stats[STAT_LFTR];
+    return 1;
+}
+
+static int
+reduce(struct loop * loop)
+{
+    struct block * block;
+    struct insn  * insn;
+    struct iv    * iv;
+    int            stores = 0;
+
+    if (loop->header == entry_block) return 0;
+
+    for (block = first_block; block; block = block->next) 
+        if (in_loop(block, loop)) 
+            for (insn = block->first_insn; insn; insn = insn->next)
+                if (insn->mem_defd) stores = 1;
+
+    for (block = first_block; block; block = block->next) {
+        if (!in_loop(block, loop)) continue;
+
+        for (insn = block->first_insn; insn; insn = insn->next) 
+            if (reduce_chain(loop, block, insn, stores)) return 1;
+    }
+
+    for (iv = ivs; iv; iv = iv->link) 
+        if ((iv->header == loop->header) && replace_test(loop, iv, stores)) 
+            return 1;
+
+    return 0;
+}
+
+/* called by optimize() after licm() has nothing more to do. like licm(),
+   the analysis is redone after every change. */
+
+int
+induction(void)
+{
+    struct loop * loop;
+    int           changes = 0;
+
+  again:
+    compute_global_defuses();
+    find_loops();
+
+    for (loop = loops; loop; loop = loop->next) {
+        if (reduce(loop)) {
+            ++changes;
+            goto again;
+        }
+    }
+
+    free_loops();
+    free_ivs();
+    return changes;
+}
+
+/* loop rotation. the parser builds loops with the test at the top:
+
+        P: ...                  H: test                 B: body
+           JMP H                   Jcc B / JMP X           JMP H
+
+   a copy of the header H is placed in a new block, G, and the entries to
+   the loop are redirected there. G guards the loop, and the original test
+   is now only reached from the bottom, so B becomes the header. this makes
+   room for a preheader (between G and B) that's only entered if the loop 
+   is, and leaves simple loops as a chain of blocks ending in their test,
+   which is what unroll() looks for. only small headers without calls are
+   copied. rotate() is only called once, from optimize(), since rotating 
+   a loop can leave another block with an exit at its head. */
+
+#define ROTATE_INSNS    8       /* largest header copied */
+
+static int
+rotate_loop(struct loop * loop)
+{
+    struct block * header = loop->header;
+    struct block * predecessor;
+    struct block * successor;
+    struct block * guard;
+    struct insn  * insn;
+    int            nr_inside = 0;
+    int            cc;
+    int            n;
+    int            i;
+
+    if (header == entry_block) return 0;
+    if (header->nr_successors != 2) return 0;
+    if (block_successor_cc(header, 0) >= CC_ALWAYS) return 0;
+    if (header->nr_insns > ROTATE_INSNS) return 0;
+
+    for (n = 0; successor = block_successor(header, n); ++n) {
+        if (successor == header) return 0;
+        if (in_loop(successor, loop)) ++nr_inside;
+    }
+
+    if (nr_inside != 1) return 0;
+
+    for (insn = header->first_insn; insn; insn = insn->next) 
+        if ((insn->opcode == I_CALL) || (insn->opcode == I_PUSH)) return 0;
+
+    for (n = 0; predecessor = block_predecessor(header, n); ++n) {
+        if (in_loop(predecessor, loop)) continue;
+        for (i = 0; block_successor(predecessor, i) != header; ++i) ;
+        if (block_successor_cc(predecessor, i) >= CC_TABLE) return 0;
+    }
+
+    guard = new_block();
+    guard->loop = loop->parent;
+    guard->loop_level = loop->depth - 1;
+
+    for (insn = header->first_insn; insn; insn = insn->next)
+        put_insn(guard, dup_insn(insn), NULL);
+
+  again:
+    for (n = 0; predecessor = block_predecessor(header, n); ++n) {
+        if (in_loop(predecessor, loop)) continue;
+
+        for (i = 0; block_successor(predecessor, i) != header; ++i) ;
+        cc = block_successor_cc(predecessor, i);
+        unsucceed_block(predecessor, i);
+        succeed_block(predecessor, cc, guard);
+        goto again;
+    }
+
+    for (n = 0; successor = block_successor(header, n); ++n)
+        succeed_block(guard, block_successor_cc(header, n), successor);
+
+    ++stats[STAT_ROTATE];
+    return 1;
+}
+
+int
+rotate(void)
+{
+    struct loop * loop;
+    int           changes = 0;
+
+    find_loops();
+
+    /* rotating a loop adds a block to its parent but 
+       otherwise leaves the forest intact, so one pass will do */
+
+    for (loop = loops; loop; loop = loop->next)
+        if (rotate_loop(loop)) ++changes;
+
+    free_loops();
+    return changes;
+}
+
+/* loop unrolling. after rotation, a simple counted loop is a chain of blocks
+   ending in a CMP of a basic induction variable J against a bound N (which is
+   a constant or invariant) that branches back to the header while J < N (or 
+   <=, >, >= as the sign of J's step requires). the chain is collapsed into a
+   single block, B, whose body (everything but the CMP) is replicated.
+
+   if J's initial value and N are known constants, the trip count T is too: 
+   if the loop is small enough, it's replaced with T copies of the body; if
+   not, T mod F copies are peeled off in front, and the loop executes F 
+   copies per iteration, testing J against N only after the last. otherwise,
+   the unrolled loop U runs only while J is at least F-1 steps short of the
+   bound, and B is kept to take up the remainder:
+
+        P: L = N - (F-1)*STEP / CMP L, N / Jcc C / JMP B     (if no overflow)
+        C: CMP J, L / Jcc U / JMP B
+        U: body * F / CMP J, L / Jcc U / JMP R
+        R: CMP J, N / Jcc B / JMP X
+
+   note that B is entered directly from P or C, since its first iteration
+   is unconditional. in the replicated body, the steps of each induction
+   variable are folded into the memory operands that follow (fold_steps()),
+   so the variable is only bumped once. */
+
+#define UNROLL_INSNS    64      /* largest unrolled body */
+#define ENTRY_BLOCKS    8       /* how far entry_value() looks back */
+#define MAX_FOLD_STEPS  8       /* induction variables per fold_steps() */
+
+int unroll_factor = UNROLL_FACTOR;     /* -u: maximum unrolling factor */
+
+/* CC_* with the operands of the comparison exchanged */
+
+static int swapped_cc[] = 
+{
+    CC_Z, CC_NZ, CC_L, CC_GE, CC_LE, CC_G, CC_B, CC_AE, CC_BE, CC_A
+};
+
+/* if 'loop' is a chain of blocks beginning at the header, which ends in
+   a block that branches back to the header or out of the loop, return 
+   that last block (the latch), otherwise NULL. */
+
+static struct block *
+latch(struct loop * loop)
+{
+    struct block * block = loop->header;
+    struct block * successor;
+    int            n;
+
+    if (block->loop != loop) return NULL;
+
+    while (block->nr_successors == 1) {
+        successor = block_successor(block, 0);
+        if ((successor == loop->header) || (successor->loop != loop)) return NULL;
+        if (successor->nr_predecessors != 1) return NULL;
+        block = successor;
+    }
+
+    if (block->nr_successors != 2) return NULL;
+    if (block_successor_cc(block, 0) >= CC_ALWAYS) return NULL;
+
+    for (n = 0; successor = block_successor(block, n); ++n) 
+        if ((successor != loop->header) && in_loop(successor, loop)) 
+            return NULL;
+
+    if ((block_successor(block, 0) == loop->header) == (block_successor(block, 1) == loop->header))
+        return NULL;
+
+    return block;
+}
+
+/* if the value of 'reg' on entry to 'block' is a known constant, return
+   non-zero and store it in 'value'. only the simplest case is recognized: 
+   a MOV (or XOR) in a straight line of blocks leading to 'block'. */
+
+static int
+entry_value(struct block * block, int reg, long * value)
+{
+    struct insn * insn;
+    int           n;
+
+    for (n = 0; n < ENTRY_BLOCKS; ++n) {
+        for (insn = block->last_insn; insn; insn = insn->previous) {
+            if (!insn_defs_reg(insn, reg)) continue;
+            if (insn_nr_defs(insn) != 1) return 0;
+
+            if ((insn->opcode == I_MOV) && (insn->operand[1]->op == E_CON)) {
+                *value = insn->operand[1]->u.con.i;
+                return 1;
+            } else if ((insn->opcode == I_XOR) && !insn_uses_reg(insn, reg)) {
+                *value = 0;
+                return 1;
+            } else
+                return 0;
+        }
+
+        if ((block == entry_block) || (block->nr_predecessors != 1)) return 0;
+        block = block_predecessor(block, 0);
+    }
+
+    return 0;
+}
+
+/* the number of times the body of a loop is executed, when J begins at 
+   'first' and steps by 'step' until the condition 'cc' with 'bound' fails.
+   the first iteration is unconditional. returns 0 if it's not clear. */
+
+static long
+trip_count(int cc, long first, long bound, long step)
+{
+    long distance;
+
+    if ((first > INT_MAX) || (first < -INT_MAX)) return 0;
+    if ((bound > INT_MAX) || (bound < -INT_MAX)) return 0;
+
+    switch (cc)
+    {
+    case CC_L:      distance = bound - first; break;
+    case CC_LE:     distance = bound - first + 1; break;
+    case CC_G:      distance = first - bound; break;
+    case CC_GE:     distance = first - bound + 1; break;
+    default:        return 0;
+    }
+
+    if (step < 0) step = -step;
+    if (distance <= step) return 1;
+    return (distance + step - 1) / step;
+}
+
+/* if 'insn' steps a pseudo by a constant, return non-zero and 
+   store the register and the amount in 'reg' and 'c'. */
+
+static int
+step_insn(struct insn * insn, int * reg, long * c)
+{
+    if (insn->operand[0]->op != E_REG) return 0;
+    if (!R_IS_PSEUDO(insn->operand[0]->u.reg)) return 0;
+    *reg = insn->operand[0]->u.reg;
+
+    switch (insn->opcode)
+    {
+    case I_INC:     *c = 1; return 1;
+    case I_DEC:     *c = -1; return 1;
+
+    case I_ADD:
+    case I_SUB:
+        if (insn->operand[1]->op != E_CON) return 0;
+        *c = insn->operand[1]->u.con.i;
+        if (insn->opcode == I_SUB) *c = -*c;
+        return (*c <= INT_MAX) && (*c >= -INT_MAX);
+
+    default:
+        return 0;
+    }
+}
+
+/* does 'insn' DEF 'reg' other than by stepping it? does it refer to 
+   'reg' at all? (these work from the operands, since replicated insns
+   haven't been analyzed.) */
+
+static int
+other_def(struct insn * insn, int reg)
+{
+    long c;
+    int  i;
+
+    if (step_insn(insn, &i, &c)) return 0;
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) 
+        if ((insn->opcode & I_DEF(i)) && (insn->operand[i]->op == E_REG) 
+          && (insn->operand[i]->u.reg == reg))
+            return 1;
+
+    return 0;
+}
+
+static int
+refers(struct insn * insn, int reg)
+{
+    struct tree * operand;
+    int           i;
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        operand = insn->operand[i];
+        if ((operand->op == E_REG) && (operand->u.reg == reg)) return 1;
+        if ((operand->op == E_MEM) && ((operand->u.mi.b == reg) || (operand->u.mi.i == reg))) return 1;
+    }
+
+    return 0;
+}
+
+/* if every reference to 'reg' in 'insn' is in the address of a memory
+   operand, adjust the displacements as if 'reg' were 'c' larger. */
+
+static int
+displace(struct insn * insn, int reg, long c)
+{
+    struct tree * operand;
+    long          ofs;
+    int           i;
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        operand = insn->operand[i];
+        if ((operand->op == E_REG) && (operand->u.reg == reg)) return 0;
+
+        if (operand->op == E_MEM) {
+            ofs = operand->u.mi.ofs;
+            if (operand->u.mi.b == reg) ofs += c;
+            if (operand->u.mi.i == reg) ofs += c * operand->u.mi.s;
+            if ((ofs > INT_MAX) || (ofs < -INT_MAX)) return 0;
+        }
+    }
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        operand = insn->operand[i];
+
+        if (operand->op == E_MEM) {
+            if (operand->u.mi.b == reg) operand->u.mi.ofs += c;
+            if (operand->u.mi.i == reg) operand->u.mi.ofs += c * operand->u.mi.s;
+        }
+    }
+
+    return 1;
+}
+
+static struct insn *
+step(int reg, long c)
+{
+    struct symbol * symbol = find_symbol_by_reg(reg);
+    int             ts;
+
+    ts = (symbol->type->ts & T_IS_QWORD) ? T_LONG : T_INT;
+    return new_insn(I_ADD, reg_tree(reg, new_type(ts)), int_tree(ts, c));
+}
+
+/* fold the steps of each induction variable in 'block' forward, into the 
+   displacements of memory operands, until an insn which needs the actual 
+   value is reached. 'last' is the CMP that ends the block (if any): steps
+   still pending there are made before it, so the flags are undisturbed. */
+
+static void
+fold_steps(struct block * block, struct insn * last)
+{
+    struct symbol * symbol;
+    struct insn   * insn;
+    struct insn   * next;
+    int             regs[MAX_FOLD_STEPS];
+    int             nr_regs = 0;
+    int             reg;
+    long            c;
+    long            d;
+    int             i;
+
+    for (insn = block->first_insn; insn; insn = insn->next) {
+        if (insn->opcode & I_USE_CC) return;
+        if (!step_insn(insn, &reg, &c)) continue;
+        for (i = 0; (i < nr_regs) && (regs[i] != reg); ++i) ;
+        if ((i == nr_regs) && (nr_regs < MAX_FOLD_STEPS)) regs[nr_regs++] = reg;
+    }
+
+    for (i = 0; i < nr_regs; ++i) {
+        reg = regs[i];
+        symbol = find_symbol_by_reg(reg);
+        if (!(symbol->ss & S_REGISTER)) continue;
+        if (!(symbol->type->ts & (T_IS_INT | T_IS_LONG | T_PTR))) continue;
+
+        for (insn = block->first_insn; insn; insn = insn->next)
+            if (other_def(insn, reg)) break;
+
+        if (insn) continue;
+
+        for (d = 0, insn = block->first_insn; insn; insn = next) {
+            next = insn->next;
+
+            if (step_insn(insn, &reg, &c) && (reg == regs[i])) {
+                if ((d + c > INT_MAX) || (d + c < -INT_MAX)) {
+                    put_insn(block, step(reg, d), insn);
+                    d = 0;
+                }
+
+                d += c;
+                kill_insn(block, insn);
+                continue;
+            }
+
+            reg = regs[i];
+            if ((d == 0) || !refers(insn, reg)) continue;
+            if (displace(insn, reg, d)) continue;
+            put_insn(block, step(reg, d), insn);
+            d = 0;
+        }
+
+        if (d) put_insn(block, step(regs[i], d), last);
+    }
+}
+
+/* append 'count' copies of the body of 'b' (all but the final CMP) to 'block' */
+
+static void
+replicate(struct block * block, struct block * b, int count)
+{
+    struct insn * insn;
+
+    while (count--) 
+        for (insn = b->first_insn; insn != b->last_insn; insn = insn->next)
+            put_insn(block, dup_insn(insn), NULL);
+}
+
+/* collapse the chain of blocks from the header of 'loop' to 'latch' into
+   the header. the blocks left behind are empty and unreachable. */
+
+static void
+collapse(struct loop * loop, struct block * latch)
+{
+    struct block * header = loop->header;
+    struct block * successor;
+    struct block * block;
+    struct insn  * insn;
+    int            cc;
+
+    while (header->nr_successors == 1) {
+        block = block_successor(header, 0);
+
+        while (insn = block->first_insn) {
+            get_insn(block, insn);
+            put_insn(header, insn, NULL);
+        }
+
+        unsucceed_block(header, 0);
+
+        while (successor = block_successor(block, 0)) {
+            cc = block_successor_cc(block, 0);
+            unsucceed_block(block, 0);
+            succeed_block(header, cc, successor);
+        }
+
+        if (block == latch) break;
+    }
+}
+
+static struct block *
+unrolled_block(struct block * b, int level)
+{
+    struct block * block = new_block();
+
+    block->loop_level = b->loop_level + level;
+    block->bs |= B_UNROLLED;
+    return block;
+}
+
+static int
+unroll_loop(struct loop * loop)
+{
+    struct block * b = loop->header;
+    struct block * pre;
+    struct block * last;
+    struct block * exit;
+    struct block * block;
+    struct block * u;
+    struct block * r;
+    struct block * c;
+    struct insn  * insn;
+    struct insn  * cmp;
+    struct tree  * j;
+    struct tree  * bound;
+    struct tree  * limit;
+    long           first;
+    long           trips = 0;
+    long           step;
+    int            nr_insns;
+    int            factor;
+    int            stores = 0;
+    int            back;
+    int            cc;
+    int            n;
+    int            i;
+
+    if (b == entry_block) return 0;
+    if (b->bs & B_UNROLLED) return 0;
+    if (b->nr_predecessors != 2) return 0;
+    last = latch(loop);
+    if (last == NULL) return 0;
+    cmp = last->last_insn;
+    if ((cmp == NULL) || (cmp->opcode != I_CMP)) return 0;
+
+    for (nr_insns = 0, block = b; ; block = block_successor(block, 0)) {
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            if ((insn->opcode == I_CALL) || (insn->opcode == I_PUSH) || (insn->opcode == I_POP))
+                return 0;
+
+            if (insn->mem_defd) stores = 1;
+            ++nr_insns;
+        }
+
+        if (block == last) break;
+    }
+
+    /* nr_insns counts the body of the loop, without the CMP */
+
+    factor = UNROLL_INSNS / --nr_insns;
+    if (factor > unroll_factor) factor = unroll_factor;
+    if (factor < 2) return 0;
+
+    for (i = 0; i < 2; ++i) 
+        if ((cmp->operand[i]->op == E_REG) && basic_iv(loop, cmp->operand[i]->u.reg, &block, &step))
+            break;
+
+    if (i == 2) return 0;
+    j = cmp->operand[i];
+    bound = cmp->operand[!i];
+
+    if (bound->op == E_REG) {
+        if (!invariant(loop, bound->u.reg, stores)) return 0;
+    } else if (bound->op != E_CON)
+        return 0;
+
+    for (back = 0; block_successor(last, back) != b; ++back) ;
+    exit = block_successor(last, !back);
+    cc = block_successor_cc(last, back);
+    if (i == 1) cc = swapped_cc[cc];
+
+    switch (cc)
+    {
+    case CC_L:
+    case CC_LE:     if (step <= 0) return 0; break;
+    case CC_G:
+    case CC_GE:     if (step >= 0) return 0; break;
+    default:        return 0;
+    }
+
+    if ((step * (factor - 1) > INT_MAX) || (step * (factor - 1) < -INT_MAX)) return 0;
+
+    for (n = 0; block_predecessor(b, n) == last; ++n) ;
+    pre = block_predecessor(b, n);
+
+    if ((bound->op == E_CON) && entry_value(pre, j->u.reg, &first)) 
+        trips = trip_count(cc, first, bound->u.con.i, step);
+
+    if (trips) {
+        if (trips * nr_insns <= UNROLL_INSNS) 
+            factor = trips;
+        else if (trips < factor)
+            return 0;
+
+        limit = NULL;
+    } else if (bound->op == E_CON) {
+        first = bound->u.con.i - step * (factor - 1);
+        if ((first > INT_MAX) || (first < -INT_MAX)) return 0;
+        limit = int_tree(j->type->ts & T_BASE, first);
+    } else 
+        limit = temporary(copy_type(j->type));
+
+    /* point of no return */
+
+    collapse(loop, last);
+    for (back = 0; block_successor(b, back) != b; ++back) ;
+    cmp = b->last_insn;
+    pre = preheader(loop);
+    unsucceed_block(pre, 0);
+    b->bs |= B_UNROLLED;
+    u = unrolled_block(b, 0);
+    replicate(u, b, factor);
+
+    if (trips == factor) {
+        /* straight-line code: B is left for dead */
+
+        fold_steps(u, NULL);
+        succeed_block(pre, CC_ALWAYS, u);
+        succeed_block(u, CC_ALWAYS, exit);
+        while (b->nr_successors) unsucceed_block(b, 0);
+    } else if (trips) {
+        /* peel the remainder, then U replaces B */
+
+        c = unrolled_block(b, -1);
+        replicate(c, b, trips % factor);
+        fold_steps(c, NULL);
+        insn = dup_insn(cmp);
+        put_insn(u, insn, NULL);
+        fold_steps(u, insn);
+        succeed_block(pre, CC_ALWAYS, c);
+        succeed_block(c, CC_ALWAYS, u);
+        succeed_block(u, block_successor_cc(b, back), u);
+        succeed_block(u, block_successor_cc(b, !back), exit);
+        while (b->nr_successors) unsucceed_block(b, 0);
+    } else {
+        /* the general case, with B as the remainder loop */
+
+        c = unrolled_block(b, -1);
+        r = unrolled_block(b, -1);
+
+        if (limit->op == E_REG) {
+            put_insn(pre, new_insn(I_MOV, copy_tree(limit), copy_tree(bound)), NULL);
+            put_insn(pre, new_insn(I_SUB, copy_tree(limit), int_tree(j->type->ts & T_BASE, 
+                                                                     step * (factor - 1))), NULL);
+            put_insn(pre, new_insn(I_CMP, copy_tree(limit), copy_tree(bound)), NULL);
+            succeed_block(pre, (step > 0) ? CC_L : CC_G, c);
+            succeed_block(pre, (step > 0) ? CC_GE : CC_LE, b);
+        } else
+            succeed_block(pre, CC_ALWAYS, c);
+
+        put_insn(c, new_insn(I_CMP, copy_tree(j), copy_tree(limit)), NULL);
+        succeed_block(c, cc, u);
+        succeed_block(c, CC_INVERT(cc), b);
+
+        insn = new_insn(I_CMP, copy_tree(j), limit);
+        put_insn(u, insn, NULL);
+        fold_steps(u, insn);
+        succeed_block(u, cc, u);
+        succeed_block(u, CC_INVERT(cc), r);
+
+        put_insn(r, dup_insn(cmp), NULL);
+        succeed_block(r, block_successor_cc(b, back), b);
+        succeed_block(r, block_successor_cc(b, !back), exit);
+    }
+
+    ++stats[STAT_UNROLL];
+    return 1;
+}
+
+/* called by optimize() with the other loop optimizations. unrolled 
+   loops (and their remainders) are marked so they're left alone. */
+
+int
+unroll(void)
+{
+    struct loop * loop;
+    int           changes = 0;
+
+    if (unroll_factor < 2) return 0;
+
+  again:
+    compute_global_defuses();
+    find_loops();
+
+    for (loop = loops; loop; loop = loop->next) {
+        if (unroll_loop(loop)) {
+            ++changes;
+            goto again;
+        }
+    }
+
+    free_loops();
+    return changes;
+}
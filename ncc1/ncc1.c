@@ -29,9 +29,14 @@
 #include <unistd.h>
 #include "ncc1.h"
 
-int             blkcpy_used;        /* if blkcpy is invoked */
+int             f_flag;             /* -f: omit frame pointer */
 int             g_flag;             /* -g: produce debug info */
 int             O_flag;             /* -O: enable optimizations */
+int             l_flag;             /* -l: block-local register allocation only */
+int             r_flag;             /* -r: pass arguments in registers */
+int             s_flag;             /* -s: schedule insns (-ss: twice) */
+int             v_flag;             /* -v: report optimizer statistics */
+int             stats[NR_STATS];    /* STAT_* counters for -v */
 FILE          * yyin;               /* lexical input */
 struct token    token;          
 struct string * input_name;         /* input file name and line number ... */
@@ -44,7 +49,9 @@ int             next_fregister = R_FPSEUDO;
 int             current_scope = SCOPE_GLOBAL;
 struct symbol * current_function;
 struct tree   * return_struct_temp;
+struct symbol * return_struct_local;    /* see return_statement() */
 int             frame_offset;
+int             arguments_size;     /* bytes of incoming stack arguments */
 int             save_iregs;         /* bitsets (1 << R_IDX(x)) of registers .. */
 int             save_fregs;         /* .. used in this function */
 int             loop_level;
@@ -127,7 +134,8 @@ static char *errors[] =
     "illegal variadic function",            /* ERROR_VARIADIC */
     "duplicate argument name",              /* ERROR_DUPARG */
     "missing argument name",                /* ERROR_ARGNAME */
-    "incorrect number of arguments"         /* ERROR_ARGCOUNT */
+    "incorrect number of arguments",        /* ERROR_ARGCOUNT */
+    "can't read profile"                    /* ERROR_PROFILE */
 };
 
 void
@@ -150,6 +158,45 @@ error(int code)
     exit(1);
 }
 
+/* report the optimizer statistics on stderr. one line per
+   counter, prefixed with the input name, so that results
+   for a set of files can be easily gathered and summed. */
+
+static char *stat_names[] =
+{
+    "copies propagated",                    /* STAT_COPY_PROP */
+    "moves coalesced",                      /* STAT_COALESCE */
+    "dead stores removed",                  /* STAT_DEAD_STORE */
+    "spill loads/stores folded",            /* STAT_FOLD */
+    "loop-invariant insns hoisted",         /* STAT_LICM */
+    "induction expressions reduced",        /* STAT_IV */
+    "loop tests replaced",                  /* STAT_LFTR */
+    "redundant computations removed",       /* STAT_CSE */
+    "tail calls",                           /* STAT_TAIL */
+    "calls inlined",                        /* STAT_INLINE */
+    "dead insns swept",                     /* STAT_DCE */
+    "insns scheduled out of order",         /* STAT_SCHED */
+    "loops rotated",                        /* STAT_ROTATE */
+    "loops unrolled",                       /* STAT_UNROLL */
+    "branches converted to CMOVcc",         /* STAT_IFCONV */
+    "redundant compares removed",           /* STAT_CMP */
+    "redundant extensions removed",         /* STAT_EXT */
+    "bit-field accesses coalesced"          /* STAT_FIELD */
+};
+
+static void
+statistics(void)
+{
+    int i;
+
+    for (i = 0; i < NR_STATS; ++i) 
+        fprintf(stderr, "%s: %d %s\n", input_name->data, stats[i], stat_names[i]);
+
+    for (i = 0; i < nr_peep_rules; ++i) 
+        if (peep_rules[i].hits)
+            fprintf(stderr, "%s: %d peephole %s\n", input_name->data, peep_rules[i].hits, peep_rules[i].name);
+}
+
 /* a general-purpose allocation function. guarantees success. */
 
 void *
@@ -163,18 +210,43 @@ allocate(int bytes)
 int
 main(int argc, char * argv[])
 {
-    int opt;
+    char * profile = NULL;
+    int    opt;
 
-    while ((opt = getopt(argc, argv, "gO")) != -1)
+    while ((opt = getopt(argc, argv, "fgi:Olrsu:vp:")) != -1)
     {
         switch (opt)
         {
         case 'O':
             ++O_flag;
             break;
+        case 'f':
+            ++f_flag;
+            break;
         case 'g':
             ++g_flag;
             break;
+        case 'i':
+            inline_limit = atoi(optarg);
+            break;
+        case 'l':
+            ++l_flag;
+            break;
+        case 'r':
+            ++r_flag;
+            break;
+        case 's':
+            ++s_flag;
+            break;
+        case 'u':
+            unroll_factor = atoi(optarg);
+            break;
+        case 'v':
+            ++v_flag;
+            break;
+        case 'p':
+            profile = optarg;
+            break;
         default:
             exit(1);
         }
@@ -194,12 +266,15 @@ main(int argc, char * argv[])
     yyin = fopen(argv[0], "r");
     if (!yyin) error(ERROR_INPUT);
 
+    if (profile) read_profile(profile);
+
     yyinit();
     translation_unit();
+    output_inlines();
     literals();
     tentatives();
     externs();
-    if (blkcpy_used) output(".global blkcpy\n");
     fclose(output_file);
+    if (v_flag) statistics();
     exit(0);
 }
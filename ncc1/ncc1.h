@@ -39,6 +39,19 @@
 #define FRAME_ARGUMENTS     16      /* start of arguments in frame */
 #define FRAME_ALIGN         8       /* always 8-byte aligned */
 
+/* with -r, the number of arguments of each class passed in registers */
+
+#define NR_IARGUMENT_REGS   6
+#define NR_FARGUMENT_REGS   8
+
+/* default maximum size (in tree nodes) of inline function bodies (-i) */
+
+#define INLINE_LIMIT        16
+
+/* default maximum factor by which counted loops are unrolled (-u) */
+
+#define UNROLL_FACTOR       4
+
 /* number of buckets in the hash tables. a power of two is preferable.
    more buckets can improve performance, but with NR_SYMBOL_BUCKETS in 
    particular, larger numbers can have a negative impact, as every bucket 
@@ -73,9 +86,16 @@
 #include "block.h"
 #include "peep.h"
 
-extern int              blkcpy_used;
+extern int              f_flag;
 extern int              g_flag;
 extern int              O_flag;
+extern int              l_flag;
+extern int              r_flag;
+extern int              s_flag;
+extern int              v_flag;
+extern int              inline_limit;
+extern int              unroll_factor;
+extern int              stats[];
 extern FILE *           yyin;
 extern struct token     token;
 extern int              line_number;
@@ -89,7 +109,9 @@ extern int              next_fregister;
 extern int              loop_level;
 extern struct symbol  * current_function;
 extern struct tree    * return_struct_temp;
+extern struct symbol  * return_struct_local;
 extern int              frame_offset;
+extern int              arguments_size;
 extern int              save_iregs;
 extern int              save_fregs;
 extern struct block *   entry_block;
@@ -97,6 +119,7 @@ extern struct block *   current_block;
 extern struct block *   exit_block;
 extern struct block *   first_block;
 extern struct block *   last_block;
+extern struct loop *    loops;
 
 extern void            error(int);
 extern void            compound(void);
@@ -109,6 +132,9 @@ extern void            prohibit(int);
 extern void            translation_unit(void);
 extern void            local_declarations(void);
 extern void            compute_global_defuses(void);
+extern void            update_defuses(struct block *);
+extern void            analyze_insn(struct insn *);
+extern void            analyze_blocks(void);
 extern void            output(char *, ...);
 extern void            output_string(struct string *, int);
 extern void            output_function(void);
@@ -140,6 +166,16 @@ extern void            enter_scope(void);
 extern void            exit_scope(int);
 extern struct type   * argument_type(struct type *, int);
 extern void            sequence_blocks(void);
+extern void            get_block(struct block *);
+extern void            put_block(struct block *, struct block *);
+extern void            layout_blocks(void);
+extern void            inline_begin(int);
+extern void            inline_return(struct tree *);
+extern FILE          * inline_end(void);
+extern struct tree   * inline_call(struct tree *, struct tree *);
+extern void            output_inlines(void);
+extern void            read_profile(char *);
+extern void            schedule(void);
 extern void            setup_blocks(void);
 extern void            free_block(struct block *);
 extern void            free_blocks(void);
@@ -150,7 +186,10 @@ extern struct tree   * fake_assignment(struct type *);
 extern struct tree   * expression(void);
 extern int             reg_is_dead(struct block *, struct insn *, int);
 extern void            kill_insn(struct block *, struct insn *);
+extern void            get_insn(struct block *, struct insn *);
 extern struct insn   * new_insn(int, ...);
+extern struct insn   * dup_insn(struct insn *);
+extern void            free_insn(struct insn *);
 extern int             insn_uses_reg(struct insn *, int);
 extern int             insn_defs_reg(struct insn *, int);
 extern int             insn_nr_defs(struct insn *);
@@ -158,8 +197,19 @@ extern int             insn_nr_uses(struct insn *);
 extern int             insn_touches_reg(struct insn *, int);
 extern void            insn_replace_reg(struct insn *, int, int);
 extern int             peep_match(struct block *, struct insn *, struct peep_match *);
+extern int             peep(struct block *, int);
+extern struct peep_rule peep_rules[];
+extern int             nr_peep_rules;
 extern void            free_tree(struct tree *);
 extern void            optimize(void);
+extern void            find_loops(void);
+extern void            free_loops(void);
+extern int             dominates(struct block *, struct block *);
+extern int             in_loop(struct block *, struct loop *);
+extern int             licm(void);
+extern int             induction(void);
+extern int             rotate(void);
+extern int             unroll(void);
 extern struct tree   * temporary(struct type *);
 extern struct symbol * temporary_symbol(struct type *);
 extern struct symbol * string_symbol(struct string *);
@@ -181,6 +231,7 @@ extern void            split_block(struct block *);
 extern int             size_of(struct type *);
 extern int             align_of(struct type *);
 extern void            segment(int);
+extern FILE          * divert(FILE *);
 extern struct type   * new_type(int);
 extern struct type   * copy_type(struct type *);
 extern void            free_type(struct type *);
@@ -190,11 +241,14 @@ extern struct defuse * find_defuse_by_symbol(struct block *, struct symbol *);
 extern struct type   * abstract_type(void);
 extern struct tree   * new_tree(int op, struct type * type, ...);
 extern struct tree   * copy_tree(struct tree *);
+extern int             same_tree(struct tree *, struct tree *);
 extern struct tree   * conditional_expression(void);
 extern void          * allocate(int);
 extern void            decap_tree(struct tree *, struct type **, struct tree **, struct tree **, struct tree **);
 extern struct tree   * reg_tree(int, struct type *);
 extern struct tree   * stack_tree(struct type *, int);
+extern int             register_arguments(struct type *);
+extern int             argument_reg(struct type *, int *, int *);
 extern struct tree   * symbol_tree(struct symbol *);
 extern struct type   * splice_types(struct type *, struct type *);
 extern struct tree   * scalar_expression(struct tree *);
@@ -203,6 +257,8 @@ extern void            commute_tree(struct tree *);
 extern void            compat_types(struct type *, struct type *, int);
 extern void            initializer(struct symbol *, int);
 extern struct tree   * generate(struct tree *, int, int *);
+extern void            generate_init(struct tree *);
+extern void            normalize(struct tree *);
 
 #ifndef NDEBUG
 extern void             debug_type(struct type *);
@@ -251,6 +307,30 @@ extern void             debug_tree(struct tree *);
 #define SEGMENT_TEXT    0           /* code */
 #define SEGMENT_DATA    1           /* initialized data */
 
+/* optimizer statistics, reported with -v. these
+   must match the indices of stat_names[] in ncc1.c */
+
+#define STAT_COPY_PROP      0       /* copies propagated */
+#define STAT_COALESCE       1       /* moves coalesced */
+#define STAT_DEAD_STORE     2       /* dead stores removed */
+#define STAT_FOLD           3       /* spill loads/stores folded */
+#define STAT_LICM           4       /* loop-invariant insns hoisted */
+#define STAT_IV             5       /* induction expressions reduced */
+#define STAT_LFTR           6       /* loop tests replaced */
+#define STAT_CSE            7       /* redundant computations removed */
+#define STAT_TAIL           8       /* tail calls */
+#define STAT_INLINE         9       /* calls inlined */
+#define STAT_DCE            10      /* dead insns swept */
+#define STAT_SCHED          11      /* insns scheduled out of order */
+#define STAT_ROTATE         12      /* loops rotated */
+#define STAT_UNROLL         13      /* loops unrolled */
+#define STAT_IFCONV         14      /* branches converted to CMOVcc */
+#define STAT_CMP            15      /* redundant compares removed */
+#define STAT_EXT            16      /* redundant extensions removed */
+#define STAT_FIELD          17      /* bit-field accesses coalesced */
+
+#define NR_STATS            18
+
 /* these codes must match the indices of errors[] in cc1.c */
 
 #define ERROR_CMDLINE       0       /* bad command line */
@@ -322,4 +402,5 @@ extern void             debug_tree(struct tree *);
 #define ERROR_DUPARG        66      /* duplicate argument name */
 #define ERROR_ARGNAME       67      /* missing argument name */
 #define ERROR_ARGCOUNT      68      /* incorrect number of arguments */
+#define ERROR_PROFILE       69      /* bad profile */
 
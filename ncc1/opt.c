@@ -22,10 +22,14 @@
  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 #include "ncc1.h"
 
 /* simple jump optimization -- replace jumps to empty blocks with
-   unconditional successors with direct jumps to those successors.
+   unconditional successors with direct jumps to those successors, and
+   conditional branches to the same block with an unconditional jump.
    this is really a requirement for half-decent code, given the
    abandon with which the parser generates empty blocks. as such,
    it's run whether -O is given or not. */
@@ -56,6 +60,19 @@ jumps(void)
                     }
                 }
             }
+
+            /* a conditional branch with both arms to the same place isn't */
+
+            if (    (block->nr_successors == 2) 
+                &&  (block_successor_cc(block, 0) < CC_ALWAYS)
+                &&  (block_successor(block, 0) == block_successor(block, 1)) )
+            {
+                successor = block_successor(block, 0);
+                unsucceed_block(block, 1);
+                unsucceed_block(block, 0);
+                succeed_block(block, CC_ALWAYS, successor);
+                ++changes;
+            }
         }
     } while (changes);
 }
@@ -86,6 +103,56 @@ unreachable(void)
 }
 
 
+/* join a block to its only successor, if it is that block's only
+   predecessor. the loop passes work on the block structure left by the
+   parser and rotate(), so this waits until they're finished. it gives
+   the late passes longer blocks to work with: e.g., a loop test split
+   from the latch can then use the CCs left by the step. the block that
+   reads register arguments is left alone, since the allocator counts on
+   it being small enough never to split (see function_definition()). the
+   caller must recompute the def/use data if any blocks were joined. */
+
+static int
+straighten(void)
+{
+    struct block * block;
+    struct block * successor;
+    struct insn  * insn;
+    int            changes = 0;
+    int            n;
+
+    again:
+    for (block = first_block; block; block = block->next) {
+        if (block == entry_block) continue;
+        if (block->bs & B_ARGUMENTS) continue;
+        if (block->nr_successors != 1) continue;
+        if (block_successor_cc(block, 0) != CC_ALWAYS) continue;
+
+        successor = block_successor(block, 0);
+        if ((successor == block) || (successor == exit_block)) continue;
+        if (successor->nr_predecessors != 1) continue;
+
+        while (insn = successor->first_insn) {
+            get_insn(successor, insn);
+            put_insn(block, insn, NULL);
+        }
+
+        unsucceed_block(block, 0);
+
+        for (n = successor->nr_successors - 1; n >= 0; --n)
+            succeed_block(block, block_successor_cc(successor, n), block_successor(successor, n));
+
+        while (successor->nr_successors)
+            unsucceed_block(successor, 0);
+
+        free_block(successor);
+        ++changes;
+        goto again;
+    }
+
+    return changes;
+}
+
 /* convert S_LOCALs to S_REGISTER. error on any undefined labels. */
 
 static void
@@ -100,6 +167,282 @@ walk1(struct symbol * symbol)
         error(ERROR_DANGLING);
 }
 
+/* named return values. if every return in a function returning a struct
+   returns the same local (see return_statement() [stmt.c]), and no one 
+   ever took its address, the local is moved into the caller's return 
+   value: its [RBP+x] references become references through the return 
+   struct pointer. the copies made by the returns then copy the object 
+   onto itself; cse() removes those done with MOVs, and REP MOVSQs of
+   an object onto itself are removed here. */
+
+static void
+nrv(void)
+{
+    struct symbol * symbol = return_struct_local;
+    struct block  * block;
+    struct insn   * insn;
+    struct insn   * next;
+    struct insn   * dead;
+    struct tree   * tree;
+    long            size;
+    int             i;
+
+    if ((symbol == NULL) || (symbol == current_function)) return;
+    if (!(symbol->ss & S_REGISTER) || (symbol->i == 0)) return;
+    size = size_of(symbol->type);
+
+    for (block = first_block; block; block = block->next) {
+        for (insn = block->first_insn; insn; insn = next) {
+            next = insn->next;
+
+            for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+                tree = insn->operand[i];
+                if ((tree->op != E_MEM) && (tree->op != E_IMM)) continue;
+                if ((tree->u.mi.b != R_BP) || (tree->u.mi.i != R_NONE) || tree->u.mi.glob) continue;
+                if ((tree->u.mi.ofs < symbol->i) || (tree->u.mi.ofs >= symbol->i + size)) continue;
+
+                tree->u.mi.b = return_struct_temp->u.reg;
+                tree->u.mi.ofs -= symbol->i;
+            }
+
+            /* LEA RDI, <x> / LEA RSI, <x> / MOV RCX, <n> / REP MOVSQ */
+
+            if (    (insn->opcode == I_REP_MOVSQ) && insn->previous 
+                &&  insn->previous->previous && insn->previous->previous->previous )
+            {
+                insn = insn->previous->previous->previous;
+
+                if (    (insn->opcode == I_LEA) && (insn->next->opcode == I_LEA)
+                    &&  same_tree(insn->operand[1], insn->next->operand[1])
+                    &&  (insn->next->next->opcode == I_MOV)
+                    &&  (insn->next->next->operand[0]->op == E_REG)
+                    &&  (insn->next->next->operand[0]->u.reg == R_CX) )
+                {
+                    while (insn != next) {
+                        dead = insn;
+                        insn = insn->next;
+                        kill_insn(block, dead);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* the depth of the stack below the return address changes as registers
+   are saved and arguments are pushed. since evaluating arguments can 
+   span blocks, the depth at the entry to each block is found by walking 
+   the flow graph from the entry block, after the prologue is in place. */
+
+static long
+stack_change(struct insn * insn)
+{
+    if (insn->opcode == I_PUSH) return 8;
+    if (insn->opcode == I_POP) return -8;
+
+    if (    ((insn->opcode == I_SUB) || (insn->opcode == I_ADD))
+        &&  (insn->operand[0]->op == E_REG) && (insn->operand[0]->u.reg == R_SP) )
+    {
+        if (insn->operand[1]->op != E_CON) error(ERROR_INTERNAL);
+        return (insn->opcode == I_SUB) ? insn->operand[1]->u.con.i : -insn->operand[1]->u.con.i;
+    }
+
+    return 0;
+}
+
+static void
+stack_depths(struct block * block, long depth)
+{
+    struct block * successor;
+    struct insn  * insn;
+    int            n;
+
+    if (block->bs & B_DEPTH) {
+        if (block->depth != depth) error(ERROR_INTERNAL);
+        return;
+    }
+
+    block->bs |= B_DEPTH;
+    block->depth = depth;
+    for (insn = block->first_insn; insn; insn = insn->next) depth += stack_change(insn);
+    for (n = 0; successor = block_successor(block, n); ++n) stack_depths(successor, depth);
+}
+
+/* with -f, RBP isn't set up as a frame pointer, and references to the 
+   frame are rewritten relative to RSP. without the saved RBP, locals
+   (negative offsets) sit immediately below the return address, and 
+   arguments (positive offsets) are 8 bytes closer than before. */
+
+static void
+omit_frame(void)
+{
+    struct block * block;
+    struct insn  * insn;
+    struct tree  * operand;
+    long           depth;
+    int            i;
+
+    for (block = first_block; block; block = block->next) {
+        if (!(block->bs & B_DEPTH)) continue;
+        depth = block->depth;
+
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+                operand = insn->operand[i];
+
+                if ((operand->op == E_MEM) && (operand->u.mi.b == R_BP)) {
+                    operand->u.mi.b = R_SP;
+                    operand->u.mi.ofs += depth;
+                    if (operand->u.mi.ofs >= depth) operand->u.mi.ofs -= 8;
+                }
+            }
+
+            depth += stack_change(insn);
+        }
+    }
+}
+
+/* a call followed by nothing but the epilogue (and moves that leave its
+   return value where it is) becomes a tail call: the epilogue is copied 
+   after the call, which is replaced with a jump. stack arguments are 
+   copied into our own incoming argument area, if they fit. this is done
+   between the creation of the epilogue and the rewrite for -f.
+
+   the epilogue is recognized by what it may contain: pops, adjustments
+   of RSP, and reloads of XMM registers from the frame. INSN_FLAG_TAIL, set 
+   by generate_call(), rules out calls the transformation isn't safe for, 
+   and we don't bother with functions that take the address of anything 
+   in the frame, since the callee might be handed the address. */
+
+static int
+tail_call(struct block * block, struct insn * call)
+{
+    struct insn  * epilogue[NR_REGS * 2 + 4];
+    struct insn  * insn;
+    struct block * b;
+    int            nr_epilogue = 0;
+    int            nr_blocks = 0;
+    int            iregs = 1 << R_IDX(R_AX);     /* registers which hold the */
+    int            fregs = 1 << R_IDX(R_XMM0);   /* callee's return value */
+    int            src;
+    int            dst;
+    long           depth;
+    long           ofs;
+
+    if (!(call->flags & INSN_FLAG_TAIL)) return 0;
+    if (call->operand[0]->op != E_IMM) return 0;
+
+    b = block;
+    insn = call->next;
+
+    for (;;) {
+        while (insn == NULL) {
+            if (b->nr_successors != 1) return 0;
+            if (++nr_blocks > NR_REGS) return 0;
+            b = block_successor(b, 0);
+            insn = b->first_insn;
+        }
+
+        if (insn->opcode == I_RET) break;
+
+        if (    ((insn->opcode == I_MOV) || (insn->opcode == I_MOVSS) || (insn->opcode == I_MOVSD))
+            &&  (insn->operand[0]->op == E_REG) && (insn->operand[1]->op == E_REG) )
+        {
+            dst = 1 << R_IDX(insn->operand[0]->u.reg);
+            src = 1 << R_IDX(insn->operand[1]->u.reg);
+
+            if (insn->opcode == I_MOV) 
+                iregs = (iregs & src) ? (iregs | dst) : (iregs & ~dst);
+            else
+                fregs = (fregs & src) ? (fregs | dst) : (fregs & ~dst);
+        } else if ((insn->opcode == I_POP) && (insn->operand[0]->op == E_REG)) {
+            iregs &= ~(1 << R_IDX(insn->operand[0]->u.reg));
+            epilogue[nr_epilogue++] = insn;
+        } else if (stack_change(insn)) {
+            epilogue[nr_epilogue++] = insn;
+        } else if (     (insn->opcode == I_MOVSD)
+                    &&  (insn->operand[0]->op == E_REG) 
+                    &&  (insn->operand[1]->op == E_MEM) && (insn->operand[1]->u.mi.b == R_BP) )
+        {
+            fregs &= ~(1 << R_IDX(insn->operand[0]->u.reg));
+            epilogue[nr_epilogue++] = insn;
+        } else
+            return 0;
+
+        if (nr_epilogue == (sizeof(epilogue) / sizeof(*epilogue))) return 0;
+        insn = insn->next;
+    }
+
+    if (!(current_function->type->next->ts & T_VOID)) {
+        if (current_function->type->next->ts & T_IS_FLOAT) {
+            if (!(fregs & (1 << R_IDX(R_XMM0)))) return 0;
+        } else {
+            if (!(iregs & (1 << R_IDX(R_AX)))) return 0;
+        }
+    }
+
+    /* the stack arguments are whatever the call left on the stack. */
+
+    for (depth = block->depth, insn = block->first_insn; insn != call; insn = insn->next) 
+        depth += stack_change(insn);
+
+    depth -= exit_block->depth;
+    if (depth > arguments_size) return 0;
+
+    /* point of no return */
+
+    for (ofs = 0; ofs < depth; ofs += FRAME_ALIGN) {
+        insn = new_insn(I_MOV, reg_tree(R_AX, new_type(T_LONG)), stack_tree(new_type(T_LONG), ofs));
+        put_insn(block, insn, call);
+        insn = new_insn(I_MOV, stack_tree(new_type(T_LONG), FRAME_ARGUMENTS + ofs), reg_tree(R_AX, new_type(T_LONG)));
+        insn->operand[0]->u.mi.b = R_BP;
+        put_insn(block, insn, call);
+    }
+
+    for (src = 0; src < nr_epilogue; ++src) put_insn(block, dup_insn(epilogue[src]), call);
+
+    while (call->next) {
+        insn = call->next;
+        get_insn(block, insn);
+        free_insn(insn);
+    }
+
+    call->opcode = I_JMP;
+    call->flags &= ~INSN_FLAG_TAIL;
+    while (block_successor(block, 0)) unsucceed_block(block, 0);
+    ++stats[STAT_TAIL];
+    return 1;
+}
+
+static void
+tail_calls(void)
+{
+    struct block * block;
+    struct insn  * insn;
+    struct insn  * call;
+
+    for (block = first_block; block; block = block->next) 
+        for (insn = block->first_insn; insn; insn = insn->next) 
+            if ((insn->opcode == I_LEA) && (insn->operand[1]->u.mi.b == R_BP)) return;
+
+    for (block = first_block; block; block = block->next) {
+        if (!(block->bs & B_DEPTH)) continue;
+
+        for (call = NULL, insn = block->first_insn; insn; insn = insn->next) 
+            if (insn->opcode == I_CALL) call = insn;
+
+        if (call && tail_call(block, call)) unreachable();
+    }
+
+    /* unreachable() won't remove the exit block, so just empty it */
+
+    if (exit_block->nr_predecessors == 0) 
+        while (insn = exit_block->first_insn) {
+            get_insn(exit_block, insn);
+            free_insn(insn);
+        }
+}
+
 /* generate function prologue and epilogue in entry and exit blocks */
 
 static void
@@ -122,8 +465,11 @@ logues(void)
     frame_offset = ROUND_UP(frame_offset, FRAME_ALIGN);
     locals = frame_offset;
 
-    put_insn(entry_block, new_insn(I_PUSH, reg_tree(R_BP, new_type(T_LONG))), NULL);
-    put_insn(entry_block, new_insn(I_MOV, reg_tree(R_BP, new_type(T_LONG)), reg_tree(R_SP, new_type(T_LONG))), NULL);
+    if (!f_flag) {
+        put_insn(entry_block, new_insn(I_PUSH, reg_tree(R_BP, new_type(T_LONG))), NULL);
+        put_insn(entry_block, new_insn(I_MOV, reg_tree(R_BP, new_type(T_LONG)), reg_tree(R_SP, new_type(T_LONG))), NULL);
+    }
+
     if (locals) put_insn(entry_block, new_insn(I_SUB, reg_tree(R_SP, new_type(T_LONG)), int_tree(T_LONG, locals)), NULL);
     
     for (i = 0; i < NR_REGS; i++) {
@@ -141,144 +487,1201 @@ logues(void)
     }
 
     if (locals) put_insn(exit_block, new_insn(I_ADD, reg_tree(R_SP, new_type(T_LONG)), int_tree(T_LONG, locals)), NULL);
-    put_insn(exit_block, new_insn(I_POP, reg_tree(R_BP, new_type(T_LONG))), NULL);
+    if (!f_flag) put_insn(exit_block, new_insn(I_POP, reg_tree(R_BP, new_type(T_LONG))), NULL);
     put_insn(exit_block, new_insn(I_RET), NULL);
+
+    stack_depths(entry_block, 0);
+    if (O_flag && !(current_function->type->next->ts & T_TAG)) tail_calls();
+    if (f_flag) omit_frame();
 }
 
-/* peephole optimizations */
+/* peephole optimizations. the rules are in peep.rules. */
 
 static int
 peeps(struct block * block)
 {
-    struct insn * insn;
+    return -peep(block, PEEP_OPT);
+}
+
+/* optimizations that are simple one-for-one substitutions.
+   these aren't processed until the last minute because they 
+   have the potential to obscure other optimizations. */
 
-    for (insn = block->first_insn; insn; insn = insn->next) 
+/* CMP <reg>, 0 or TEST <reg>, <reg> after an insn that computed <reg> and
+   set the CCs from it is redundant, if nothing in between touches either.
+   all the insns here set ZF and SF from the result, but only the logical
+   insns clear OF and CF like the compare does, so after the arithmetic 
+   insns only CC_Z and CC_NZ consumers are allowed. a shift by zero leaves
+   the CCs alone, so only shifts by (nonzero) constants qualify. the CCs
+   of the insn that remains are now used, so it's flagged INSN_FLAG_CC. */
+
+#define CCS_NONE    0       /* the CCs don't reflect the result */
+#define CCS_ZERO    1       /* only CC_Z and CC_NZ are valid */
+#define CCS_ALL     2       /* the CCs are as CMP <reg>, 0 would set them */
+
+static int
+ccs_from(struct insn * insn)
+{
+    switch (insn->opcode)
     {
-        /* AND <reg>, <??> -> TEST <reg>, <??> */
+    case I_AND:
+    case I_OR:
+    case I_XOR:     return CCS_ALL;
+
+    case I_SHL:
+    case I_SHR:
+    case I_SAR:     if (insn->operand[1]->op != E_CON) return CCS_NONE;
+                    if ((insn->operand[1]->u.con.i & 31) == 0) return CCS_NONE;
+                    /* fall through */
+    case I_ADD:
+    case I_SUB:
+    case I_INC:
+    case I_DEC:
+    case I_NEG:     return CCS_ZERO;
+
+    default:        return CCS_NONE;
+    }
+}
 
-        {
-            static struct peep_match test[] = 
-            {
-                { I_AND, 0, { { T_IS_SCALAR, PMO_REG | PMO_DEAD } } },
-                { I_NONE }
-            };
+static int
+cc_ok(int cc, int ccs)
+{
+    if (cc >= CC_ALWAYS) return 1;
+    if (ccs == CCS_ALL) return 1;
+    return (cc == CC_Z) || (cc == CC_NZ);
+}
 
-            if (peep_match(block, insn, test)) 
-            {
-                insn->opcode = I_TEST;
-                return -1;
-            }
+/* are the CCs set by 'cmp' only consumed in ways that 'ccs' allows? */
+
+static int
+cc_consumers(struct block * block, struct insn * cmp, int ccs)
+{
+    struct insn * insn;
+    int           cc;
+    int           n;
+
+    for (insn = cmp->next; insn; insn = insn->next) {
+        if (insn->opcode & I_USE_CC) {
+            if ((insn->opcode >= I_SETZ) && (insn->opcode <= I_SETB))
+                cc = insn->opcode - I_SETZ;
+            else if ((insn->opcode >= I_CMOVZ) && (insn->opcode <= I_CMOVB))
+                cc = insn->opcode - I_CMOVZ;
+            else
+                return 0;
+
+            if (!cc_ok(cc, ccs)) return 0;
         }
+
+        if (insn->opcode & I_DEF_CC) return 1;
     }
 
-    return 0;
+    for (n = 0; n < block->nr_successors; ++n)
+        if (!cc_ok(block_successor_cc(block, n), ccs)) return 0;
+
+    return 1;
+}
+
+static void
+compares(struct block * block)
+{
+    struct insn * insn;
+    struct insn * cmp;
+    struct insn * next;
+    struct tree * reg;
+    int           ccs;
+
+    for (cmp = block->first_insn; cmp; cmp = next) {
+        next = cmp->next;
+
+        if ((cmp->opcode != I_CMP) && (cmp->opcode != I_TEST)) continue;
+        reg = cmp->operand[0];
+        if (reg->op != E_REG) continue;
+
+        if (cmp->opcode == I_CMP) {
+            if ((cmp->operand[1]->op != E_CON) || cmp->operand[1]->u.con.i) continue;
+        } else if ((cmp->operand[1]->op != E_REG) || (cmp->operand[1]->u.reg != reg->u.reg))
+            continue;
+
+        for (insn = cmp->previous; insn; insn = insn->previous) {
+            if (insn->opcode & I_DEF_CC) break;
+            if (insn_defs_reg(insn, reg->u.reg)) break;
+        }
+
+        if ((insn == NULL) || !(insn->opcode & I_DEF_CC)) continue;
+        if ((ccs = ccs_from(insn)) == CCS_NONE) continue;
+        if (insn->operand[0]->op != E_REG) continue;
+        if (insn->operand[0]->u.reg != reg->u.reg) continue;
+        if (size_of(insn->operand[0]->type) != size_of(reg->type)) continue;
+        if (!cc_consumers(block, cmp, ccs)) continue;
+
+        insn->flags |= INSN_FLAG_CC;
+        kill_insn(block, cmp);
+        ++stats[STAT_CMP];
+    }
 }
 
+/* IMUL <reg>, c -> LEA <reg>, [reg,reg*(f-1)] for each factor f of 3, 5
+   or 9 in c, then SHL <reg>, n for any factor 2^n. a LEA is a one-cycle
+   insn and IMUL is three, so this is only done if it takes two insns at
+   most. (IMUL by a power of two alone is left to the peephole rules.) */
 
-/* optimizations that are simple one-for-one substitutions.
-   these aren't processed until the last minute because they 
-   have the potential to obscure other optimizations. */
+static void
+mul_lea(struct block * block)
+{
+    static int     factors[] = { 9, 5, 3 };
+    struct insn  * insn;
+    struct insn  * next;
+    struct tree  * reg;
+    struct tree  * mem;
+    long           c;
+    int            f[2];
+    int            nr_f;
+    int            shift;
+    int            i;
+
+    for (insn = block->first_insn; insn; insn = next) {
+        next = insn->next;
+        if (insn->opcode != I_IMUL) continue;
+        if (insn->flags & INSN_FLAG_CC) continue;
+        reg = insn->operand[0];
+        if (!(reg->type->ts & (T_IS_INT | T_IS_LONG))) continue;
+        if (insn->operand[1]->op != E_CON) continue;
+        c = insn->operand[1]->u.con.i;
+        if (c <= 0) continue;
+
+        for (shift = 0; !(c & 1); c >>= 1) ++shift;
+
+        for (nr_f = 0, i = 0; (i < 3) && (nr_f < 2); ) {
+            if (c % factors[i]) 
+                ++i;
+            else {
+                f[nr_f++] = factors[i];
+                c /= factors[i];
+            }
+        }
+
+        if ((c != 1) || (nr_f == 0) || (nr_f + (shift != 0) > 2)) continue;
+
+        for (i = 0; i < nr_f; ++i) {
+            mem = new_tree(E_MEM, new_type(T_LONG));
+            mem->u.mi.b = reg->u.reg;
+            mem->u.mi.i = reg->u.reg;
+            mem->u.mi.s = f[i] - 1;
+            put_insn(block, new_insn(I_LEA, copy_tree(reg), mem), insn);
+        }
+
+        if (shift) put_insn(block, new_insn(I_SHL, copy_tree(reg), int_tree(T_INT, (long) shift)), insn);
+        kill_insn(block, insn);
+    }
+}
 
 static void
 subs(struct block * block)
+{
+    compares(block);
+    peep(block, PEEP_SUBS);
+    mul_lea(block);
+}
+
+/* copy propagation. after a MOV (or MOVSS/MOVSD) into an unaliased
+   register, the source is substituted for the destination in the USEs
+   of subsequent insns in the block, until either is redefined. the
+   copies left behind are usually dead and swept up by dead_stores().
+
+   register sources must be pseudo registers, and only replace views
+   no wider than the copy. constants are propagated only where the
+   legality bits (I_CON) allow, and then only if they fit in 32 bits.
+   memory sources are only folded into a single USE in an operand
+   that allows it (I_MEM), when the destination dies there, since we
+   don't want to replace one load with several. non-register sources
+   and aliased registers are only good until the next memory write. 
+
+   every copy in the block is propagated in one pass: each insn changed
+   is reanalyzed as we go, and the def/use data is updated at the end.
+   the USEs only move within the block, so the global data stays valid.
+   (a register's last_n may be stale in between, but a copy into it
+   ends the propagation of any earlier copy from it.) */
+
+static int
+copy_prop_con(struct insn * insn, int i, struct tree * src)
+{
+    struct tree * operand = insn->operand[i];
+    struct tree * con;
+    int           ts;
+
+    if (!(insn->opcode & I_CON(i))) return 0;
+    ts = (operand->type->ts & T_PTR) ? T_LONG : (operand->type->ts & T_BASE);
+    con = int_tree(ts, src->u.con.i);
+    normalize(con);
+
+    if ((con->u.con.i < INT_MIN) || (con->u.con.i > INT_MAX)) {
+        free_tree(con);
+        return 0;
+    }
+
+    free_tree(operand);
+    insn->operand[i] = con;
+    return 1;
+}
+
+static int
+copy_prop_mem(struct block * block, struct insn * copy, struct insn * insn, int i)
+{
+    struct tree * operand = insn->operand[i];
+    struct tree * src = copy->operand[1];
+    int           reg = copy->operand[0]->u.reg;
+    int           j;
+
+    if (!(insn->opcode & I_MEM(i))) return 0;
+    if (size_of(operand->type) != size_of(src->type)) return 0;
+    if (src->type->ts & T_VOLATILE) return 0;
+    if (!reg_is_dead(block, insn, reg)) return 0;
+
+    for (j = 0; j < I_NR_OPERANDS(insn->opcode); ++j) {
+        if (insn->operand[j]->op == E_MEM) return 0;
+        if ((j != i) && (insn->operand[j]->op == E_REG) && (insn->operand[j]->u.reg == reg)) return 0;
+    }
+
+    insn->operand[i] = copy_tree(src);
+    free_type(insn->operand[i]->type);
+    insn->operand[i]->type = copy_type(operand->type);
+    free_tree(operand);
+    analyze_insn(insn);
+    kill_insn(block, copy);
+    return 1;
+}
+
+static int
+copy_prop1(struct block * block, struct insn * copy)
+{
+    struct tree   * dst = copy->operand[0];
+    struct tree   * src = copy->operand[1];
+    struct insn   * insn;
+    struct insn   * next;
+    struct tree   * operand;
+    struct defuse * defuse;
+    int             volatile_src = 0;
+    int             changes = 0;
+    int             size;
+    int             n;
+    int             i;
+
+    size = size_of(dst->type);
+
+    if (src->op == E_REG) {
+        defuse = find_defuse(block, src->u.reg, FIND_DEFUSE_NORMAL);
+        if (defuse == NULL) return 0;
+        if (!(defuse->symbol->ss & S_REGISTER)) volatile_src = 1;
+    } else if (src->op == E_MEM)
+        volatile_src = 1;
+
+    for (insn = copy->next; insn; insn = next) {
+        next = insn->next;
+        n = changes;
+
+        for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+            operand = insn->operand[i];
+
+            if (operand->op == E_REG) {
+                if (operand->u.reg != dst->u.reg) continue;
+                if (!(insn->opcode & I_USE(i)) || (insn->opcode & I_DEF(i))) continue;
+
+                if (src->op == E_MEM)
+                    return copy_prop_mem(block, copy, insn, i);
+                else if (size_of(operand->type) > size)
+                    continue;
+                else if (src->op == E_CON)
+                    changes += copy_prop_con(insn, i, src);
+                else {
+                    operand->u.reg = src->u.reg;
+                    ++changes;
+                }
+            } else if (operand->op == E_MEM) {
+                if ((src->op != E_REG) || (size != 8)) continue;
+
+                if (operand->u.mi.b == dst->u.reg) {
+                    operand->u.mi.b = src->u.reg;
+                    ++changes;
+                }
+
+                if (operand->u.mi.i == dst->u.reg) {
+                    operand->u.mi.i = src->u.reg;
+                    ++changes;
+                }
+            }
+        }
+
+        if (changes != n) analyze_insn(insn);
+        if (insn_touches_reg(insn, dst->u.reg) && (src->op == E_MEM)) break;
+        if (insn_defs_reg(insn, dst->u.reg)) break;
+        if (volatile_src && insn->mem_defd) break;
+
+        if (src->op == E_REG) {
+            if (insn_defs_reg(insn, src->u.reg)) break;
+        } else if (src->op == E_MEM) {
+            if ((src->u.mi.b != R_NONE) && insn_defs_reg(insn, src->u.mi.b)) break;
+            if ((src->u.mi.i != R_NONE) && insn_defs_reg(insn, src->u.mi.i)) break;
+        }
+    }
+
+    return changes;
+}
+
+static int
+copy_prop(struct block * block)
 {
     struct insn * insn;
+    struct insn * next;
+    int           changes = 0;
     int           i;
 
-    for (insn = block->first_insn; insn; insn = insn->next) {
-        { 
-            /* ADD <??>, 1 -> INC <??>
-               SUB <??>, -1 -> INC <??> */
+    static struct peep_match copy[] =
+    {
+        { I_ANY, 0, { { T_IS_SCALAR, PMO_REG | PMO_UNALIASED }, { T_IS_SCALAR } } },
+        { I_NONE }
+    };
+
+    for (insn = block->first_insn; insn; insn = next) {
+        next = insn->next;
+        if ((insn->opcode != I_MOV) && (insn->opcode != I_MOVSS) && (insn->opcode != I_MOVSD)) continue;
+        if (!peep_match(block, insn, copy)) continue;
+        if (!R_IS_PSEUDO(insn->operand[0]->u.reg)) continue;
+
+        if (insn->operand[1]->op == E_REG) {
+            if (!R_IS_PSEUDO(insn->operand[1]->u.reg)) continue;
+
+            if (insn->operand[1]->u.reg == insn->operand[0]->u.reg) {
+                if (size_of(insn->operand[0]->type) == size_of(insn->operand[1]->type)) {
+                    kill_insn(block, insn);
+                    ++changes;
+                }
+                continue;
+            }
+        } else if ((insn->operand[1]->op != E_CON) && (insn->operand[1]->op != E_MEM))
+            continue;
+
+        if (i = copy_prop1(block, insn)) {
+            stats[STAT_COPY_PROP] += i;
+            changes += i;
+        }
+    }
+
+    if (changes) update_defuses(block);
+    return changes;
+}
+
+/* a limited, local form of register coalescing, mainly to clean up after
+   the code generator, which computes into temporaries and then copies
+   the result to its destination. given MOV <x>, <t> where <t> is a
+   temporary that dies there, and <x> is unaliased, we rename <t> to <x>
+   throughout <t>'s lifetime (and drop the MOV) if their live ranges don't
+   interfere: <x> can't be DEFd while <t> is live, nor USEd after the insn
+   that first DEFs <t> (that insn may read <x>, since it reads before it
+   writes). the result is computed directly into the destination. as
+   in copy_prop(), all the block's candidates are handled in one pass,
+   keeping just enough of the local data current for the next: the 
+   insns renamed, and where <x> now first appears. */
+
+static int
+coalesce(struct block * block)
+{  
+    struct insn   * insn;
+    struct insn   * next;
+    struct insn   * first;
+    struct insn   * tmp;
+    struct defuse * src;
+    struct defuse * dst;
+    int             changes = 0;
+    int             size;
+
+    for (insn = block->first_insn; insn; insn = next) {
+        next = insn->next;
+        if ((insn->opcode != I_MOV) && (insn->opcode != I_MOVSS) && (insn->opcode != I_MOVSD)) continue;
+        if ((insn->operand[0]->op != E_REG) || (insn->operand[1]->op != E_REG)) continue;
+        if (insn->operand[0]->u.reg == insn->operand[1]->u.reg) continue;
+
+        dst = find_defuse(block, insn->operand[0]->u.reg, FIND_DEFUSE_NORMAL);
+        src = find_defuse(block, insn->operand[1]->u.reg, FIND_DEFUSE_NORMAL);
+        if ((dst == NULL) || (src == NULL)) continue;
+        if (!DU_TEMP(*src) || (src->last_n != insn->n)) continue;
+        if (!(dst->symbol->ss & S_REGISTER)) continue;
+
+        size = size_of(dst->symbol->type);
+        if (size != size_of(src->symbol->type)) continue;
+        if (size != size_of(insn->operand[0]->type)) continue;
+        if (size != size_of(insn->operand[1]->type)) continue;
+
+        for (first = block->first_insn; first->n != src->first_n; first = first->next) ;
+        if (!insn_defs_reg(first, src->symbol->reg)) continue;
+
+        for (tmp = first; tmp != insn; tmp = tmp->next) {
+            if (insn_defs_reg(tmp, dst->symbol->reg)) break;
+            if ((tmp != first) && insn_uses_reg(tmp, dst->symbol->reg)) break;
+        }
+
+        if (tmp != insn) continue;
+
+        for (tmp = first; tmp != insn; tmp = tmp->next) {
+            insn_replace_reg(tmp, src->symbol->reg, dst->symbol->reg);
+            analyze_insn(tmp);
+        }
+
+        if (dst->first_n > first->n) dst->first_n = first->n;
+        kill_insn(block, insn);
+        ++stats[STAT_COALESCE];
+        ++changes;
+    }
+
+    if (changes) update_defuses(block);
+    return changes;
+}
+
+/* remove dead code (dead stores): any instruction that
+   only DEFs a register whose value is never used, and
+   has no other side effects, is dead code. */
+
+static int
+dead_stores(struct block * block)
+{
+    struct insn * insn;
+    struct insn * next;
+    int           kills = 0;
+
+    for (insn = block->first_insn; insn; insn = next) {
+        next = insn->next;
+
+        /* no side effects:
+           1. can't set condition codes that are inspected
+           2. no memory reads
+           3. no memory writes
+           4. only one register DEFd
+           5. reg is dead after insn */
+
+        if (insn->flags & INSN_FLAG_CC) continue; 
+        if (insn->mem_used) continue;
+        if (insn->mem_defd) continue;      
+        if (insn_nr_defs(insn) != 1) continue; 
+        if (!reg_is_dead(block, insn, insn->regs_defd[0])) continue;
+
+        kill_insn(block, insn);
+        ++stats[STAT_DEAD_STORE];
+        ++kills;
+    }
+
+    return -kills; 
+}
+
+/* mark-and-sweep dead code elimination, over the whole function. some
+   insns are live from the start because of their side effects: memory
+   writes, calls, stack manipulation, jumps, and anything that sets CCs
+   that are examined. the registers they USE are needed, as are all real
+   registers and those of symbols that aren't S_REGISTER; any insn that
+   DEFs a needed register is live, and so on. everything else is swept.
+   unlike dead_stores(), this catches dead chains that span blocks, and
+   insns that DEF more than one register. */
+
+static char * needed_regs[2];
+
+static char *
+needed(int reg)
+{
+    if (!R_IS_PSEUDO(reg)) return NULL;
+    return &needed_regs[(reg & R_IS_FLOAT) != 0][R_IDX(reg)];
+}
+
+static int
+live(struct insn * insn)
+{
+    char * p;
+    int    i;
+
+    if (insn->mem_defd || (insn->flags & INSN_FLAG_CC)) return 1;
+    if (insn->opcode & I_STRING) return 1;
+
+    switch (insn->opcode) 
+    {
+    case I_CALL:
+    case I_PUSH:
+    case I_POP:
+    case I_JMP:
+    case I_RET:
+        return 1;
+    }
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) 
+        if (    (insn->operand[i]->op == E_MEM) 
+            &&  (insn->operand[i]->type->ts & T_VOLATILE) ) return 1;
+
+    for (i = 0; i < NR_INSN_REGS; ++i) {
+        if (insn->regs_defd[i] == R_NONE) continue;
+        p = needed(insn->regs_defd[i]);
+        if ((p == NULL) || *p) return 1;
+    }
+
+    return 0;
+}
+
+static int
+dce(void)
+{
+    struct block  * block;
+    struct defuse * defuse;
+    struct insn   * insn;
+    struct insn   * next;
+    char          * p;
+    int             changes;
+    int             kills = 0;
+    int             i;
+
+    needed_regs[0] = allocate(R_IDX(next_iregister));
+    needed_regs[1] = allocate(R_IDX(next_fregister));
+    memset(needed_regs[0], 0, R_IDX(next_iregister));
+    memset(needed_regs[1], 0, R_IDX(next_fregister));
+
+    for (block = first_block; block; block = block->next) 
+        for (defuse = block->defuses; defuse; defuse = defuse->link) 
+            if (!(defuse->symbol->ss & S_REGISTER) && (p = needed(defuse->symbol->reg))) 
+                *p = 1;
+
+    do {
+        changes = 0;
+
+        for (block = first_block; block; block = block->next) {
+            for (insn = block->first_insn; insn; insn = insn->next) {
+                if (!live(insn)) continue;
+
+                for (i = 0; i < NR_INSN_REGS; ++i) {
+                    if (insn->regs_used[i] == R_NONE) continue;
+                    p = needed(insn->regs_used[i]);
+
+                    if (p && !*p) {
+                        *p = 1;
+                        ++changes;
+                    }
+                }
+            }
+        }
+    } while (changes);
+
+    for (block = first_block; block; block = block->next) {
+        for (insn = block->first_insn; insn; insn = next) {
+            next = insn->next;
+            if (live(insn)) continue;
+
+            kill_insn(block, insn);
+            ++stats[STAT_DCE];
+            ++kills;
+        }
+    }
+
+    free(needed_regs[0]);
+    free(needed_regs[1]);
+    return kills;
+}
+
+/* if-conversion. a conditional branch around a few cheap insns that only
+   compute register values (a triangle, or a diamond with insns in both
+   arms) is replaced by straight-line code that computes both arms and then
+   selects the results with CMOVcc. this is the shape of min/max, clamps,
+   abs and the like, whose conditions are data-dependent and predict badly:
+
+        H: ... / CMP / Jcc A / JMP B            H: ... / A' / B' / CMP
+        A: MOV R, X / JMP J             =>         CMOVcc R, TA
+        B: MOV R, Y / JMP J                        CMOVncc R, TB / JMP J
+
+   each arm is copied to H ahead of the CMP, with the registers it DEFs 
+   renamed to fresh temporaries (A' and B' above), so the arms don't 
+   interfere; copy propagation and dead stores clean up after. an arm 
+   can only be executed unconditionally if it has no side effects, can't
+   fault (loads only from fixed addresses, no division), only DEFs 
+   unaliased pseudos, and its results are at least 32 bits (CMOV has no 
+   byte form). the DEFs of each arm are renamed in the order they appear,
+   so there are never more than NR_INSN_REGS * IFCONV_INSNS of them. */
+
+#define IFCONV_INSNS    4       /* longest arm converted */
+
+static int
+speculable(struct insn * insn)
+{
+    struct symbol * symbol;
+    struct tree   * operand;
+    int             reg;
+    int             i;
+
+    switch (insn->opcode)
+    {
+    case I_MOV:     case I_MOVSX:   case I_MOVZX:   case I_LEA:
+    case I_ADD:     case I_SUB:     case I_AND:     case I_OR:
+    case I_XOR:     case I_SHL:     case I_SHR:     case I_SAR:
+    case I_IMUL:    case I_NEG:     case I_NOT:     case I_INC:
+    case I_DEC:     case I_CMP:     case I_TEST:
+        break;
+
+    default:
+        if ((insn->opcode >= I_SETZ) && (insn->opcode <= I_SETB)) break;
+        if ((insn->opcode >= I_CMOVZ) && (insn->opcode <= I_CMOVB)) break;
+        return 0;
+    }
+
+    if (insn->mem_defd) return 0;
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        operand = insn->operand[i];
+        if (operand->op != E_MEM) continue;
+        if (insn->opcode == I_LEA) continue;
+        if (operand->type->ts & T_VOLATILE) return 0;
+        if (operand->u.mi.i != R_NONE) return 0;
+        if ((operand->u.mi.b != R_NONE) && (operand->u.mi.b != R_BP)) return 0;
+    }
+
+    for (i = 0; (i < NR_INSN_REGS) && ((reg = insn->regs_defd[i]) != R_NONE); ++i) {
+        if (!R_IS_PSEUDO(reg) || (reg & R_IS_FLOAT)) return 0;
+        symbol = find_symbol_by_reg(reg);
+        if (!(symbol->ss & S_REGISTER)) return 0;
+    }
+
+    return 1;
+}
+
+/* is 'arm' a block which can be converted? */
+
+static int
+convertible(struct block * arm)
+{
+    struct defuse * defuse;
+    struct insn   * insn;
+    int             cc = 0;
+    int             i;
+
+    if (arm->nr_insns > IFCONV_INSNS) return 0;
+
+    for (insn = arm->first_insn; insn; insn = insn->next) {
+        if (!speculable(insn)) return 0;
+        if ((insn->opcode & I_USE_CC) && !cc) return 0;
+        if (insn->opcode & I_DEF_CC) cc = 1;
+
+        for (i = 0; (i < NR_INSN_REGS) && (insn->regs_defd[i] != R_NONE); ++i) {
+            defuse = find_defuse(arm, insn->regs_defd[i], FIND_DEFUSE_NORMAL);
+
+            if (    (defuse->dus & DU_OUT) 
+                &&  !(defuse->symbol->type->ts & (T_IS_INT | T_IS_LONG | T_PTR)) )
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* copy 'arm' into 'head' before 'cmp', renaming the registers it DEFs
+   as described above. returns the number of renamed registers. */
+
+static int
+rename_arm(struct block * head, struct insn * cmp, struct block * arm, int * from, int * to)
+{
+    struct symbol * symbol;
+    struct insn   * insn;
+    struct insn   * copy;
+    int             nr = 0;
+    int             reg;
+    int             i;
+    int             k;
+
+    for (insn = arm->first_insn; insn; insn = insn->next) {
+        copy = dup_insn(insn);
+        for (k = 0; k < nr; ++k) insn_replace_reg(copy, from[k], to[k]);
+
+        for (i = 0; (i < NR_INSN_REGS) && ((reg = insn->regs_defd[i]) != R_NONE); ++i) {
+            for (k = 0; (k < nr) && (from[k] != reg); ++k) ;
+            if (k < nr) continue;
+
+            symbol = find_symbol_by_reg(reg);
+            from[nr] = reg;
+            to[nr] = symbol_reg(temporary_symbol(copy_type(symbol->type)));
+
+            if (insn_uses_reg(insn, reg)) 
+                put_insn(head, new_insn(I_MOV, reg_tree(to[nr], copy_type(symbol->type)),
+                                               reg_tree(reg, copy_type(symbol->type))), cmp);
+
+            insn_replace_reg(copy, reg, to[nr]);
+            ++nr;
+        }
+
+        put_insn(head, copy, cmp);
+    }
+
+    return nr;
+}
+
+/* is 'reg' among the 'nr' registers DEFd in 'arm', and live out of it? */
+
+static int
+result(struct block * arm, int * from, int nr, int reg)
+{
+    struct defuse * defuse;
+
+    while (nr--) {
+        if (from[nr] == reg) {
+            defuse = find_defuse(arm, reg, FIND_DEFUSE_NORMAL);
+            return defuse && (defuse->dus & DU_OUT);
+        }
+    }
+
+    return 0;
+}
+
+static int
+diamond(struct block * head)
+{
+    struct block  * arm[2];
+    struct block  * join = NULL;
+    struct insn   * cmp = head->last_insn;
+    struct symbol * symbol;
+    int             from[2][NR_INSN_REGS * IFCONV_INSNS];
+    int             to[2][NR_INSN_REGS * IFCONV_INSNS];
+    int             nr[2];
+    int             opcode;
+    int             n;
+    int             k;
+
+    if (head->nr_successors != 2) return 0;
+    if (block_successor_cc(head, 0) >= CC_ALWAYS) return 0;
+    if ((cmp == NULL) || !(cmp->opcode & I_DEF_CC)) return 0;
+
+    /* an arm is a block entered only from 'head' that leads unconditionally
+       to the join; the other successor of 'head' may be the join itself */
+
+    for (n = 0; n < 2; ++n) {
+        arm[n] = block_successor(head, n);
+
+        if (    (arm[n]->nr_predecessors == 1) && (arm[n]->nr_successors == 1) 
+            &&  (block_successor_cc(arm[n], 0) == CC_ALWAYS) 
+            &&  (arm[n] != entry_block) && (arm[n] != exit_block) )
+        {
+            if (join && (join != block_successor(arm[n], 0))) return 0;
+            join = block_successor(arm[n], 0);
+        } else
+            arm[n] = NULL;
+    }
+
+    if (join == NULL) return 0;
+
+    for (n = 0; n < 2; ++n) {
+        if (arm[n] == NULL) {
+            if (block_successor(head, n) != join) return 0;
+        } else if (!convertible(arm[n]))
+            return 0;
+    }
+
+    if ((join == head) || (join == arm[0]) || (join == arm[1])) return 0;
+
+    for (n = 0; n < 2; ++n) 
+        nr[n] = arm[n] ? rename_arm(head, cmp, arm[n], from[n], to[n]) : 0;
+
+    /* the results of arm 1 are selected first: where arm 0 
+       computes the same register, a plain MOV will do */
+
+    for (n = 1; n >= 0; --n) {
+        for (k = 0; k < nr[n]; ++k) {
+            if (!result(arm[n], from[n], nr[n], from[n][k])) continue;
+            symbol = find_symbol_by_reg(from[n][k]);
+            opcode = I_CMOVZ + block_successor_cc(head, n);
+            if ((n == 1) && result(arm[0], from[0], nr[0], from[n][k])) opcode = I_MOV;
+
+            put_insn(head, new_insn(opcode, reg_tree(from[n][k], copy_type(symbol->type)),
+                                            reg_tree(to[n][k], copy_type(symbol->type))), NULL);
+        }
+    }
+
+    for (n = 0; n < 2; ++n) 
+        if (arm[n]) unsucceed_block(arm[n], 0);
+
+    while (head->nr_successors) unsucceed_block(head, 0);
+    succeed_block(head, CC_ALWAYS, join);
+
+    ++stats[STAT_IFCONV];
+    return 1;
+}
+
+static int
+if_convert(void)
+{
+    struct block * block;
+    int            changes = 0;
+
+  again:
+    compute_global_defuses();
+
+    for (block = first_block; block; block = block->next) {
+        if (diamond(block)) {
+            ++changes;
+            goto again;
+        }
+    }
+
+    return changes;
+}
+
+/* local value numbering. each value computed in the block is assigned a 
+   number: two computations get the same number if they apply the same 
+   operation to operands with the same numbers. when an insn computes a 
+   value already held in some other (unaliased pseudo) register, it is 
+   replaced with a copy from that register. the code generator leaves 
+   the chains that compute the result (MOV T, I / IMUL T, 8 / ADD T, B) 
+   behind as dead stores, and copy propagation cleans up after the copy.
+
+   memory values are numbered too, by address, so redundant loads are 
+   eliminated (and stored values forwarded to later loads), as are stores
+   of the value the memory already holds (see nrv()). all memory
+   values are forgotten at the next memory write (which includes calls), 
+   as are the values of aliased registers. since aliased registers are 
+   written back to memory before any memory access, a DEF of an aliased 
+   register also clobbers memory. volatile memory is never numbered. */
+
+struct value
+{
+    int             op;         /* I_* opcode, or E_* for leaves */
+    int             size;
+    int             vn1, vn2;   /* operand value numbers */
+    long            con;        /* E_CON value or address offset */
+    struct symbol * glob;       /* E_IMM: address symbol */
+    int             s;          /* E_IMM: index scale */
+    int             mem;        /* memory value: forget on writes */
+    int             vn;
+    struct value  * link;
+};
+
+struct vreg
+{
+    int             reg;
+    int             size;       /* size at which 'vn' was written */
+    int             vn;
+    int             aliased;    /* forget on memory writes */
+    struct vreg   * link;
+};
+
+static struct value * values;
+static struct vreg  * vregs;
+static int            next_vn;
+
+static int
+number(int op, int size, int vn1, int vn2, long con, struct symbol * glob, int s, int mem)
+{
+    struct value * value;
+
+    for (value = values; value; value = value->link) 
+        if (    (value->op == op) && (value->size == size)
+            &&  (value->vn1 == vn1) && (value->vn2 == vn2)
+            &&  (value->con == con) && (value->glob == glob)
+            &&  (value->s == s)     )
+        {
+            return value->vn;
+        }
+
+    value = allocate(sizeof(struct value));
+    value->op = op;
+    value->size = size;
+    value->vn1 = vn1;
+    value->vn2 = vn2;
+    value->con = con;
+    value->glob = glob;
+    value->s = s;
+    value->mem = mem;
+    value->vn = ++next_vn;
+    value->link = values;
+    values = value;
+
+    return value->vn;
+}
+
+static struct vreg *
+find_vreg(struct block * block, int reg)
+{
+    struct defuse * defuse;
+    struct vreg   * vreg;
+
+    for (vreg = vregs; vreg; vreg = vreg->link)
+        if (vreg->reg == reg) return vreg;
+
+    vreg = allocate(sizeof(struct vreg));
+    vreg->reg = reg;
+    vreg->size = 0;
+    vreg->vn = ++next_vn;
+    defuse = find_defuse(block, reg, FIND_DEFUSE_NORMAL);
+    vreg->aliased = defuse && !(defuse->symbol->ss & S_REGISTER);
+    vreg->link = vregs;
+    vregs = vreg;
+
+    return vreg;
+}
+
+/* the value number of 'reg' when read at 'size'. the number of a value
+   written at one size is useless at another, so a fresh one is made. */
+
+static int
+reg_vn(struct block * block, int reg, int size)
+{
+    struct vreg * vreg;
+
+    vreg = find_vreg(block, reg);
+
+    if (vreg->size != size) {
+        vreg->size = size;
+        vreg->vn = ++next_vn;
+    }
+
+    return vreg->vn;
+}
+
+static void
+set_reg_vn(struct block * block, int reg, int size, int vn)
+{
+    struct vreg * vreg;
+
+    vreg = find_vreg(block, reg);
+    vreg->size = size;
+    vreg->vn = vn;
+}
+
+/* the value number of the address of an E_MEM or E_IMM operand */
+
+static int
+addr_vn(struct block * block, struct tree * tree)
+{
+    int b = 0;
+    int i = 0;
+
+    if (tree->u.mi.b != R_NONE) b = reg_vn(block, tree->u.mi.b, 8);
+    if (tree->u.mi.i != R_NONE) i = reg_vn(block, tree->u.mi.i, 8);
+    if (tree->u.mi.rip) b = -1;
+
+    return number(E_IMM, 0, b, i, tree->u.mi.ofs, tree->u.mi.glob, 
+                 (tree->u.mi.i != R_NONE) ? tree->u.mi.s : 0, 0);
+}
+
+static int
+operand_vn(struct block * block, struct tree * tree)
+{
+    int size = size_of(tree->type);
+
+    switch (tree->op)
+    {
+    case E_CON:     return number(E_CON, size, 0, 0, tree->u.con.i, NULL, 0, 0);
+    case E_REG:     return reg_vn(block, tree->u.reg, size);
+    case E_IMM:     return addr_vn(block, tree);
+
+    case E_MEM:     
+        if (tree->type->ts & T_VOLATILE) return ++next_vn;
+        return number(E_MEM, size, addr_vn(block, tree), 0, 0, NULL, 0, 1);
+    }
+
+    return ++next_vn;
+}
+
+/* after a memory write, forget everything in memory, and the 
+   values of the aliased registers, by renumbering them. */
+
+static void
+forget_memory(void)
+{
+    struct value * value;
+    struct vreg  * vreg;
+
+    for (value = values; value; value = value->link)
+        if (value->mem) value->vn = ++next_vn;
+
+    for (vreg = vregs; vreg; vreg = vreg->link)
+        if (vreg->aliased) vreg->vn = ++next_vn;
+}
+
+/* return an unaliased pseudo, other than 'reg', which 
+   holds 'vn' at 'size' in the register class of 'reg'. */
+
+static int
+holder(int vn, int size, int reg)
+{
+    struct vreg * vreg;
 
-            static struct peep_match test1[] = 
-            {
-                { I_ADD, PMI_CCS_UNUSED, { { T_IS_SCALAR }, { T_IS_SCALAR, PMO_CON | PMO_VALUE, 1 } } },
-                { I_NONE }
-            };
+    for (vreg = vregs; vreg; vreg = vreg->link) {
+        if ((vreg->vn != vn) || (vreg->size != size)) continue;
+        if ((vreg->reg == reg) || vreg->aliased || !R_IS_PSEUDO(vreg->reg)) continue;
+        if ((vreg->reg & (R_IS_INTEGRAL | R_IS_FLOAT)) != (reg & (R_IS_INTEGRAL | R_IS_FLOAT))) continue;
+        return vreg->reg;
+    }
 
-            static struct peep_match test2[] = 
-            {
-                { I_SUB, PMI_CCS_UNUSED, { { T_IS_SCALAR }, { T_IS_SCALAR, PMO_CON | PMO_VALUE, -1 } } },
-                { I_NONE }
-            };
-
-            if (peep_match(block, insn, test1) || peep_match(block, insn, test2)) {
-                insn->opcode = I_INC;
-                free_tree(insn->operand[1]);
-                insn->operand[1] = NULL;
-            }
-        }
+    return R_NONE;
+}
 
-        { 
-            /* ADD <??>, -1 -> DEC <??>
-               SUB <??>, 1 -> DEC <??> */
+/* compute the value number of the result of 'insn', which
+   DEFs the register in operand 0, or return 0 if unknown. */
 
-            static struct peep_match test1[] = 
-            {
-                { I_SUB, PMI_CCS_UNUSED, { { T_IS_SCALAR }, { T_IS_SCALAR, PMO_CON | PMO_VALUE, 1 } } },
-                { I_NONE }
-            };
+static int
+result_vn(struct block * block, struct insn * insn)
+{
+    struct tree * dst = insn->operand[0];
+    struct tree * src = insn->operand[1];
+    int           size = size_of(dst->type);
+    int           vn1;
+    int           vn2;
 
-            static struct peep_match test2[] = 
-            {
-                { I_ADD, PMI_CCS_UNUSED, { { T_IS_SCALAR }, { T_IS_SCALAR, PMO_CON | PMO_VALUE, -1 } } },
-                { I_NONE }
-            };
-
-            if (peep_match(block, insn, test1) || peep_match(block, insn, test2)) {
-                insn->opcode = I_DEC;
-                free_tree(insn->operand[1]);
-                insn->operand[1] = NULL;
-            }
+    switch (insn->opcode)
+    {
+    case I_MOV:
+    case I_MOVSS:
+    case I_MOVSD:
+        return operand_vn(block, src);
+
+    case I_LEA:
+        return addr_vn(block, src);
+
+    case I_MOVSX:       case I_MOVZX:       case I_CVTSS2SI:    
+    case I_CVTSD2SI:    case I_CVTSI2SS:    case I_CVTSI2SD:    
+    case I_CVTSS2SD:    case I_CVTSD2SS:
+        return number(insn->opcode, size, operand_vn(block, src), 0, 0, NULL, 0, 0);
+
+    case I_NEG:
+    case I_NOT:
+        return number(insn->opcode, size, reg_vn(block, dst->u.reg, size), 0, 0, NULL, 0, 0);
+
+    case I_SUB:         case I_SHL:         case I_SHR:         
+    case I_SAR:         case I_SUBSS:       case I_SUBSD:       
+    case I_DIVSS:       case I_DIVSD:
+        vn1 = reg_vn(block, dst->u.reg, size);
+        vn2 = operand_vn(block, src);
+        return number(insn->opcode, size, vn1, vn2, 0, NULL, 0, 0);
+
+    case I_ADD:         case I_IMUL:        case I_AND:         
+    case I_OR:          case I_XOR:         case I_ADDSS:
+    case I_ADDSD:       case I_MULSS:       case I_MULSD:
+        vn1 = reg_vn(block, dst->u.reg, size);
+        vn2 = operand_vn(block, src);
+
+        if (vn1 > vn2) {
+            vn1 ^= vn2;
+            vn2 ^= vn1;
+            vn1 ^= vn2;
         }
 
-        /* easy ones left on the table:
-            IMUL by a constant power of two = SHL
-            MOV <reg>, 0 = XOR <reg>, <reg> */
+        return number(insn->opcode, size, vn1, vn2, 0, NULL, 0, 0);
     }
+
+    return 0;
 }
 
-/* reminder to do a limited local form of register coalescing 
-   to, among other things, clean up the code generator temps */
+/* a MOV from a register or constant is already as cheap as it gets */
 
 static int
-coalesce(struct block * block)
-{  
-    return 0;
-}
+copy_insn(struct insn * insn)
+{
+    if ((insn->opcode != I_MOV) && (insn->opcode != I_MOVSS) && (insn->opcode != I_MOVSD))
+        return 0;
 
-/* remove dead code (dead stores): any instruction that
-   only DEFs a register whose value is never used, and
-   has no other side effects, is dead code. */
+    return (insn->operand[1]->op == E_REG) || (insn->operand[1]->op == E_CON);
+}
 
 static int
-dead_stores(struct block * block)
+cse(struct block * block)
 {
-    struct insn * insn;
-    struct insn * next;
-    int           kills = 0;
+    struct insn  * insn;
+    struct insn  * next;
+    struct tree  * dst;
+    struct value * value;
+    struct vreg  * vreg;
+    int            changes = 0;
+    int            size;
+    int            reg;
+    int            vn;
+    int            i;
 
     for (insn = block->first_insn; insn; insn = next) {
         next = insn->next;
+        dst = insn->operand[0];
+        vn = 0;
 
-        /* no side effects:
-           1. can't set condition codes that are inspected
-           2. no memory reads
-           3. no memory writes
-           4. only one register DEFd
-           5. reg is dead after insn */
+        /* a store of the value the memory already holds is redundant */
 
-        if (insn->flags & INSN_FLAG_CC) continue; 
-        if (insn->mem_used) continue;
-        if (insn->mem_defd) continue;      
-        if (insn_nr_defs(insn) != 1) continue; 
-        if (!reg_is_dead(block, insn, insn->regs_defd[0])) continue;
+        if (    ((insn->opcode == I_MOV) || (insn->opcode == I_MOVSS) || (insn->opcode == I_MOVSD))
+            &&  (dst->op == E_MEM) && !(dst->type->ts & T_VOLATILE) )
+        {
+            vn = operand_vn(block, insn->operand[1]);
+            size = size_of(dst->type);
+
+            if (vn == number(E_MEM, size, addr_vn(block, dst), 0, 0, NULL, 0, 1)) {
+                kill_insn(block, insn);
+                ++stats[STAT_CSE];
+                ++changes;
+                continue;
+            }
 
-        kill_insn(block, insn);
-        ++kills;
+            vn = 0;
+        }
+
+        if (    (I_NR_OPERANDS(insn->opcode) >= 1) && (dst->op == E_REG) 
+            &&  (insn_nr_defs(insn) == 1) && insn_defs_reg(insn, dst->u.reg)
+            &&  !insn->mem_defd )
+        {
+            vn = result_vn(block, insn);
+        }
+
+        if (vn) {
+            size = size_of(dst->type);
+            reg = holder(vn, size, dst->u.reg);
+
+            if ((reg != R_NONE) && R_IS_PSEUDO(dst->u.reg) && !(insn->flags & INSN_FLAG_CC)) {
+                if (!copy_insn(insn)) {
+                    if (reg & R_IS_FLOAT) 
+                        i = (size == 4) ? I_MOVSS : I_MOVSD;
+                    else
+                        i = I_MOV;
+
+                    free_tree(insn->operand[1]);
+                    insn->opcode = i;
+                    insn->operand[1] = reg_tree(reg, copy_type(dst->type));
+                    ++stats[STAT_CSE];
+                    ++changes;
+                }
+            }
+
+            set_reg_vn(block, dst->u.reg, size, vn);
+        } else {
+            for (i = 0; i < insn_nr_defs(insn); ++i) 
+                find_vreg(block, insn->regs_defd[i])->vn = ++next_vn;
+        }
+
+        for (i = 0; i < insn_nr_defs(insn); ++i) 
+            if (find_vreg(block, insn->regs_defd[i])->aliased) 
+                forget_memory();
+            
+        if (insn->mem_defd) {
+            forget_memory();
+
+            /* a store: remember what's now in memory */
+
+            if (    (insn->opcode == I_MOV) || (insn->opcode == I_MOVSS) 
+                ||  (insn->opcode == I_MOVSD) )
+            {
+                if ((dst->op == E_MEM) && !(dst->type->ts & T_VOLATILE)) {
+                    vn = operand_vn(block, insn->operand[1]);
+                    size = size_of(dst->type);
+                    i = number(E_MEM, size, addr_vn(block, dst), 0, 0, NULL, 0, 1);
+
+                    for (value = values; value; value = value->link) 
+                        if (value->vn == i) value->vn = vn;
+                }
+            }
+        }
     }
 
-    return -kills; 
+    while (value = values) {
+        values = value->link;
+        free(value);
+    }
+
+    while (vreg = vregs) {
+        vregs = vreg->link;
+        free(vreg);
+    }
+
+    return -changes;
 }
 
 /* constant propogation. step through the block and track if a register
@@ -365,15 +1768,520 @@ con_prop(struct block * block)
 }
  
 
+/* redundant sign/zero extensions. the code generator extends every
+   char and short it promotes, whether or not the value was extended 
+   already, and whether or not anything but the low bits is ever used.
+
+   the first case is found by tracking what's known about the upper bits 
+   of each (unaliased) register through the block, in its defuse 'ext': 
+   the value fits in EXT_BITS() bits, unsigned or EXT_SIGNED, throughout
+   the EXT_WIDTH() low bytes of the register. (32-bit writes zero the 
+   upper half, so an unsigned value is good for 8 bytes.) MOVZX/MOVSX of 
+   a register that already holds the extended value is just a MOV.
+
+   the second case is a MOVZX/MOVSX whose result only ever reaches the 
+   low bits of anything: i.e., it only flows through insns whose low bits 
+   depend only on the low bits of their operands, and is used no wider 
+   than it was before it was extended. the MOV suffices here, too.
+
+   either way, the MOV is only made if the source register is at least 
+   as wide as the destination (so its upper bits exist to be copied). 
+   copy propagation and dead store elimination do the rest. */
+
+#define EXT_BITS(x)             ((x) & 0xFF)
+#define EXT_SIGNED              0x100
+#define EXT_WIDTH(x)            ((x) >> 16)
+#define EXT(bits, sign, width)  ((bits) | (sign) | ((width) << 16))
+
+static int
+ext_of(struct block * block, struct tree * tree, int width)
+{
+    struct defuse * defuse;
+    long            con;
+    int             ext = 0;
+
+    if (tree->op == E_CON) {
+        con = tree->u.con.i;
+
+        if ((con >= 0) && (con <= 0xFF)) ext = EXT(8, 0, 8);
+        else if ((con >= 0) && (con <= 0xFFFF)) ext = EXT(16, 0, 8);
+        else if ((con >= -128) && (con <= 127)) ext = EXT(8, EXT_SIGNED, 8);
+        else if ((con >= -32768) && (con <= 32767)) ext = EXT(16, EXT_SIGNED, 8);
+    } else if ((tree->op == E_REG) && R_IS_PSEUDO(tree->u.reg)) {
+        defuse = find_defuse(block, tree->u.reg, FIND_DEFUSE_NORMAL);
+        if (defuse && (defuse->symbol->ss & S_REGISTER)) ext = defuse->ext;
+    }
+
+    return (EXT_WIDTH(ext) >= width) ? ext : 0;
+}
+
+/* the state of a register written 'width' bytes wide with 'ext' */
+
+static int
+ext_result(int ext, int width)
+{
+    if ((ext == 0) || (width < 4)) return 0;
+    if (ext & EXT_SIGNED) return EXT(EXT_BITS(ext), EXT_SIGNED, width);
+    return EXT(EXT_BITS(ext), 0, 8);
+}
+
+static int
+ext_insn(struct block * block, struct insn * insn)
+{
+    struct tree * dst = insn->operand[0];
+    struct tree * src = insn->operand[1];
+    int           width = size_of(dst->type);
+    int           ext0;
+    int           ext1;
+
+    switch (insn->opcode)
+    {
+    case I_MOVZX:   return ext_result(EXT(size_of(src->type) * 8, 0, 8), width);
+    case I_MOVSX:   return ext_result(EXT(size_of(src->type) * 8, EXT_SIGNED, 8), width);
+    case I_MOV:     return ext_result(ext_of(block, src, width), width);
+
+    case I_SHR:
+    case I_SAR:     if (src->op != E_CON) return 0;
+                    ext0 = ext_of(block, dst, width);
+                    if ((insn->opcode == I_SHR) && (ext0 & EXT_SIGNED)) return 0;
+                    return ext_result(ext0, width);
+
+    case I_AND:
+    case I_OR:
+    case I_XOR:     ext0 = ext_of(block, dst, width);
+                    ext1 = ext_of(block, src, width);
+
+                    if (insn->opcode == I_AND) {
+                        /* clearing bits can only make an unsigned value smaller */
+                        if (ext0 && !(ext0 & EXT_SIGNED) && (!ext1 || (ext1 & EXT_SIGNED) || (EXT_BITS(ext0) <= EXT_BITS(ext1)))) 
+                            return ext_result(ext0, width);
+                        if (ext1 && !(ext1 & EXT_SIGNED)) 
+                            return ext_result(ext1, width);
+                    }
+
+                    if ((ext0 == 0) || (ext1 == 0)) return 0;
+                    if ((ext0 & EXT_SIGNED) != (ext1 & EXT_SIGNED)) return 0;
+                    return ext_result((EXT_BITS(ext0) > EXT_BITS(ext1)) ? ext0 : ext1, width);
+
+    default:        return 0;
+    }
+}
+
+/* can the MOVZX/MOVSX 'insn' become a MOV, given what's 
+   known about the upper bits of the source register? */
+
+static int
+extended(struct block * block, struct insn * insn)
+{
+    struct tree * src = insn->operand[1];
+    int           bits = size_of(src->type) * 8;
+    int           ext;
+
+    ext = ext_of(block, src, size_of(insn->operand[0]->type));
+    if (ext == 0) return 0;
+
+    if (insn->opcode == I_MOVZX)
+        return !(ext & EXT_SIGNED) && (EXT_BITS(ext) <= bits);
+    else
+        return (ext & EXT_SIGNED) ? (EXT_BITS(ext) <= bits) : (EXT_BITS(ext) < bits);
+}
+
+/* is the result of the MOVZX/MOVSX 'insn' only ever truncated? */
+
+#define MAX_TRUNCATED   8
+
+static int
+truncated(struct block * block, struct insn * insn)
+{
+    int             regs[MAX_TRUNCATED];
+    int             nr_regs = 1;
+    int             size = size_of(insn->operand[1]->type);
+    struct defuse * defuse;
+    struct tree   * operand;
+    int             wide;
+    int             i;
+    int             k;
+
+    regs[0] = insn->operand[0]->u.reg;
+
+    for (insn = insn->next; insn; insn = insn->next) {
+        wide = 0;
+
+        for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+            operand = insn->operand[i];
+
+            if (operand->op == E_MEM) {
+                for (k = 0; k < nr_regs; ++k)
+                    if ((operand->u.mi.b == regs[k]) || (operand->u.mi.i == regs[k])) return 0;
+            } else if ((operand->op == E_REG) && (insn->opcode & I_USE(i))) {
+                for (k = 0; (k < nr_regs) && (operand->u.reg != regs[k]); ++k) ;
+                if ((k < nr_regs) && (size_of(operand->type) > size)) wide = 1;
+            }
+        }
+
+        if (wide) {
+            /* the low bits of the results of these depend only 
+               on the low bits of their operands (not their CCs) */
+
+            switch (insn->opcode)
+            {
+            case I_MOV:     case I_ADD:     case I_SUB:     case I_IMUL:
+            case I_AND:     case I_OR:      case I_XOR:     case I_SHL:
+            case I_NEG:     case I_NOT:     case I_INC:     case I_DEC:
+                break;
+            default:
+                return 0;
+            }
+
+            if (insn->flags & INSN_FLAG_CC) return 0;
+
+            operand = insn->operand[0];
+            if ((operand->op != E_REG) || !R_IS_PSEUDO(operand->u.reg)) return 0;
+            defuse = find_defuse(block, operand->u.reg, FIND_DEFUSE_NORMAL);
+            if (!(defuse->symbol->ss & S_REGISTER)) return 0;
+
+            for (k = 0; (k < nr_regs) && (operand->u.reg != regs[k]); ++k) ;
+
+            if (k == nr_regs) {
+                if (nr_regs == MAX_TRUNCATED) return 0;
+                regs[nr_regs++] = operand->u.reg;
+            }
+        } else if ((I_NR_OPERANDS(insn->opcode) > 0) && (insn->opcode & I_DEF(0))) {
+            /* a full-width write puts things right again */
+
+            operand = insn->operand[0];
+
+            if ((operand->op == E_REG) && (size_of(operand->type) >= 4)) {
+                for (k = 0; k < nr_regs; ++k) {
+                    if (regs[k] == operand->u.reg) {
+                        regs[k] = regs[--nr_regs];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < nr_regs; ++k) {
+        defuse = find_defuse(block, regs[k], FIND_DEFUSE_NORMAL);
+        if (defuse->dus & DU_OUT) return 0;
+    }
+
+    return 1;
+}
+
+static int
+extensions(struct block * block)
+{
+    struct defuse * defuse;
+    struct insn   * insn;
+    struct tree   * dst;
+    struct tree   * src;
+    int             changes = 0;
+    int             i;
+
+    for (defuse = block->defuses; defuse; defuse = defuse->link)
+        defuse->ext = 0;
+
+    for (insn = block->first_insn; insn; insn = insn->next) {
+        if ((insn->opcode == I_MOVZX) || (insn->opcode == I_MOVSX)) {
+            dst = insn->operand[0];
+            src = insn->operand[1];
+
+            if (    (dst->op == E_REG) && R_IS_PSEUDO(dst->u.reg)
+                &&  (src->op == E_REG) && R_IS_PSEUDO(src->u.reg)
+                &&  (size_of(find_symbol_by_reg(src->u.reg)->type) >= size_of(dst->type))
+                &&  (find_symbol_by_reg(dst->u.reg)->ss & S_REGISTER)
+                &&  (extended(block, insn) || truncated(block, insn)) )
+            {
+                insn->opcode = I_MOV;
+                insn->operand[1] = reg_tree(src->u.reg, copy_type(dst->type));
+                free_tree(src);
+                ++stats[STAT_EXT];
+                ++changes;
+            }
+        }
+
+        /* any register DEFd gets its new state (if any) */
+
+        for (i = 0; (i < NR_INSN_REGS) && (insn->regs_defd[i] != R_NONE); ++i) {
+            defuse = find_defuse(block, insn->regs_defd[i], FIND_DEFUSE_NORMAL);
+            if (defuse == NULL) continue;
+
+            if (    (I_NR_OPERANDS(insn->opcode) == 2) && (insn->operand[0]->op == E_REG)
+                &&  (insn->operand[0]->u.reg == insn->regs_defd[i]) )
+            {
+                defuse->ext = ext_insn(block, insn);
+            } else
+                defuse->ext = 0;
+        }
+    }
+
+    return changes;
+}
+
+/* bit-field accesses. insert_field() [gen.c] stores each field with a
+   read-modify-write of its own on the containing word:
+
+        AND <word>, <mask>
+        OR <word>, <value>
+
+   so building a header a field at a time hits memory twice per field.
+   when a run of ANDs and ORs to the same (non-volatile) word is broken
+   by no other memory access, the word is instead loaded into a new
+   temporary, the ANDs and ORs are applied there, and it's stored once.
+   constant operands are folded along the way: a run of constant fields
+   leaves one AND and one OR, or, when every bit of the word is written, 
+   just a MOV of the constant.
+
+   extract_field() loads the word into the temporary it shifts the field
+   out of, so cse() finds no register still holding the word when the 
+   next field is read. a run of loads of the same word not broken by a 
+   memory write is therefore given a new temporary, loaded once, which
+   the loads of the run are rewritten to copy. 
+
+   aliased registers are kept out of runs entirely, since they are in 
+   memory whenever the word might be touched. */
+
+static int
+field_unaliased(struct block * block, struct insn * insn)
+{
+    struct defuse * defuse;
+    int             i;
+
+    for (i = 0; (i < NR_INSN_REGS) && (insn->regs_used[i] != R_NONE); ++i) {
+        defuse = find_defuse(block, insn->regs_used[i], FIND_DEFUSE_NORMAL);
+        if (defuse && !(defuse->symbol->ss & S_REGISTER)) return 0;
+    }
+
+    for (i = 0; (i < NR_INSN_REGS) && (insn->regs_defd[i] != R_NONE); ++i) {
+        defuse = find_defuse(block, insn->regs_defd[i], FIND_DEFUSE_NORMAL);
+        if (defuse && !(defuse->symbol->ss & S_REGISTER)) return 0;
+    }
+
+    return 1;
+}
+
+static int
+field_load(struct block * block, struct insn * insn, struct tree * word)
+{
+    if ((insn->opcode != I_MOV) || (insn->operand[0]->op != E_REG)) return 0;
+    if (!same_tree(insn->operand[1], word)) return 0;
+    if ((word->u.mi.b != R_NONE) && insn_defs_reg(insn, word->u.mi.b)) return 0;
+    if ((word->u.mi.i != R_NONE) && insn_defs_reg(insn, word->u.mi.i)) return 0;
+
+    return field_unaliased(block, insn);
+}
+
+static int
+field_op(struct block * block, struct insn * insn, struct tree * word)
+{
+    if ((insn->opcode != I_AND) && (insn->opcode != I_OR)) return 0;
+    if (insn->flags & INSN_FLAG_CC) return 0;
+    if (!same_tree(insn->operand[0], word)) return 0;
+    if ((insn->operand[1]->op != E_CON) && (insn->operand[1]->op != E_REG)) return 0;
+
+    return field_unaliased(block, insn);
+}
+
+/* can 'insn' sit between two insns of a run on 'word'? the CCs of a 
+   run of stores are never used (see field_op()), but new insns which 
+   set them are put in the run, so nothing inside may use CCs either. */
+
+static int
+field_gap(struct block * block, struct insn * insn, struct tree * word, int load)
+{
+    if (insn->mem_defd) return 0;
+    if (!load && (insn->mem_used || (insn->opcode & I_USE_CC))) return 0;
+    if ((word->u.mi.b != R_NONE) && insn_defs_reg(insn, word->u.mi.b)) return 0;
+    if ((word->u.mi.i != R_NONE) && insn_defs_reg(insn, word->u.mi.i)) return 0;
+
+    return field_unaliased(block, insn);
+}
+
+/* a constant operand for an insn on 'word', holding the low 'bits' of
+   'con'. an unsigned int with its high bit set is given as an int, for 
+   the same reason as in insert_field(). */
+
+static struct tree *
+field_con(struct tree * word, int bits, long con)
+{
+    struct tree * tree;
+    int           ts = word->type->ts & T_BASE;
+
+    if (ts == T_UINT) ts = T_INT;
+    if (bits < 64) con &= ~(-1L << bits);
+    tree = int_tree(ts, con);
+    normalize(tree);
+
+    return tree;
+}
+
+/* emit the pending (temp & mask) | or before 'before'. if the word
+   hasn't been loaded yet, it's loaded now, unless it need not be. */
+
+static void
+field_flush(struct block * block, struct insn * before, struct tree * word, 
+            int reg, int * loaded, long * mask, long * or)
+{
+    int  bits = size_of(word->type) * BITS;
+    long all = (bits < 64) ? ~(-1L << bits) : -1L;
+
+    *mask &= all;
+    *or &= all;
+
+    if (!*loaded && (*mask == 0)) 
+        put_insn(block, new_insn(I_MOV, reg_tree(reg, copy_type(word->type)),
+                                        field_con(word, bits, *or)), before);
+    else {
+        if (!*loaded) 
+            put_insn(block, new_insn(I_MOV, reg_tree(reg, copy_type(word->type)),
+                                            copy_tree(word)), before);
+
+        if (*mask != all) 
+            put_insn(block, new_insn(I_AND, reg_tree(reg, copy_type(word->type)),
+                                            field_con(word, bits, *mask)), before);
+        if (*or)
+            put_insn(block, new_insn(I_OR, reg_tree(reg, copy_type(word->type)),
+                                           field_con(word, bits, *or)), before);
+    }
+
+    *loaded = 1;
+    *mask = -1L;
+    *or = 0;
+}
+
+/* rewrite the run from 'first' to 'last' on 'word'. returns the store. */
+
+static struct insn *
+field_run(struct block * block, struct insn * first, struct insn * last, struct tree * word)
+{
+    struct insn * insn;
+    struct insn * next;
+    struct insn * store;
+    long          mask = -1L;
+    long          or = 0;
+    int           loaded = 0;
+    int           done;
+    int           reg;
+
+    reg = symbol_reg(temporary_symbol(copy_type(word->type)));
+
+    for (insn = first; ; insn = next) {
+        next = insn->next;
+        done = (insn == last);
+
+        if (    ((insn->opcode == I_AND) || (insn->opcode == I_OR))
+            &&  same_tree(insn->operand[0], word) )
+        {
+            if (insn->operand[1]->op == E_CON) {
+                if (insn->opcode == I_AND) {
+                    mask &= insn->operand[1]->u.con.i;
+                    or &= insn->operand[1]->u.con.i;
+                } else
+                    or |= insn->operand[1]->u.con.i;
+
+                kill_insn(block, insn);
+            } else {
+                field_flush(block, insn, word, reg, &loaded, &mask, &or);
+                free_tree(insn->operand[0]);
+                insn->operand[0] = reg_tree(reg, copy_type(word->type));
+            }
+        }
+
+        if (done) break;
+    }
+
+    field_flush(block, next, word, reg, &loaded, &mask, &or);
+    store = new_insn(I_MOV, copy_tree(word), reg_tree(reg, copy_type(word->type)));
+    put_insn(block, store, next);
+
+    return store;
+}
+
+/* rewrite the run of loads from 'first' to 'last' of 'word' */
+
+static void
+field_loads(struct block * block, struct insn * first, struct insn * last, struct tree * word)
+{
+    struct insn * insn;
+    int           reg;
+
+    reg = symbol_reg(temporary_symbol(copy_type(word->type)));
+    put_insn(block, new_insn(I_MOV, reg_tree(reg, copy_type(word->type)), copy_tree(word)), first);
+
+    for (insn = first; ; insn = insn->next) {
+        if (field_load(block, insn, word)) {
+            free_tree(insn->operand[1]);
+            insn->operand[1] = reg_tree(reg, copy_type(word->type));
+        }
+
+        if (insn == last) break;
+    }
+}
+
+static int
+fields(struct block * block)
+{
+    struct insn * insn;
+    struct insn * last;
+    struct insn * next;
+    struct tree * word;
+    int           changes = 0;
+    int           load;
+    int           n;
+
+    for (insn = block->first_insn; insn; insn = insn->next) {
+        if (I_NR_OPERANDS(insn->opcode) != 2) continue;
+
+        load = (insn->opcode == I_MOV);
+        word = insn->operand[load ? 1 : 0];
+        if ((word->op != E_MEM) || (word->type->ts & T_VOLATILE)) continue;
+
+        if (load ? !field_load(block, insn, word) : !field_op(block, insn, word)) 
+            continue;
+
+        last = insn;
+        n = 1;
+
+        for (next = insn->next; next; next = next->next) {
+            if (load ? field_load(block, next, word) : field_op(block, next, word)) {
+                last = next;
+                ++n;
+            } else if (!field_gap(block, next, word, load))
+                break;
+        }
+
+        if (n > 1) {
+            word = copy_tree(word);
+
+            if (load) 
+                field_loads(block, insn, last, word);
+            else
+                insn = field_run(block, insn, last, word);
+
+            free_tree(word);
+            ++stats[STAT_FIELD];
+            ++changes;
+        }
+    }
+
+    return -changes;
+}
+
 struct optimizer
 {
     int     level;
     int ( * func ) (struct block *);
 } optimizers[] = {
     { 1, peeps },       /* order needs to be thought out */
+    { 1, copy_prop },
+    { 1, cse },
     { 1, coalesce },
     { 1, dead_stores },     
-    { 1, con_prop }
+    { 1, con_prop },
+    { 1, extensions },
+    { 1, fields }
 };
 
 #define NR_OPTIMIZERS (sizeof(optimizers)/sizeof(*optimizers))
@@ -391,6 +2299,16 @@ optimize(void)
 
     succeed_block(current_block, CC_ALWAYS, exit_block);
     walk_symbols(SCOPE_FUNCTION, SCOPE_RETIRED, walk1);
+    if (O_flag) nrv();
+
+    /* loops are rotated before anything else, so the optimizers
+       only ever see them in their guarded, bottom-tested form. */
+
+    if (O_flag) {
+        jumps();
+        unreachable();
+        rotate();
+    }
 
     /* optimize in a loop until no more optimizations are done.
        each local optimization function will return non-zero if
@@ -422,12 +2340,22 @@ optimize(void)
         }
     } while (again);
 
+    /* the global sweep and the loop optimizations work best once the local
+       optimizations have settled, and in turn give them more to do. */
+
+    if (O_flag && (dce() || if_convert() || licm() || induction() || unroll())) goto restart;
+
     if (O_flag) {
+        if (straighten()) compute_global_defuses();
+
         for (block = first_block; block; block = block->next)
             subs(block);
     }
 
+    if (s_flag > 1) schedule();
     allocate_regs();
+    if (s_flag) schedule();
     frame_offset = ROUND_UP(frame_offset, FRAME_ALIGN);
     logues();
+    if (O_flag) layout_blocks();
 }
@@ -232,17 +232,31 @@ output(char * fmt, ...)
 /* emit assembler directive to select the appropriate
    SEGMENT_*, if not already selected */
 
+static int current_segment = -1;
+
 void
 segment(int new)
 {
-    static int current = -1;
-
-    if (new != current) {
+    if (new != current_segment) {
         output("%s\n", (new == SEGMENT_TEXT) ? ".text" : ".data");
-        current = new;
+        current_segment = new;
     }
 }
 
+/* send subsequent output to 'file', returning the old one. the segment selection is forgotten,
+   so a diverted file stands on its own, and can be copied into another 
+   as long as output to the latter is diverted back to it afterwards. */
+
+FILE *
+divert(FILE * file)
+{
+    FILE * old = output_file;
+
+    output_file = file;
+    current_segment = -1;
+    return old;
+}
+
 /* output 'length' bytes of 'string' to the assembler output.
    the caller is assumed to have selected the appropriate segment
    and emitted a label, if necessary. if 'length' exceeds the 
@@ -288,25 +302,14 @@ static char *insns[] =
         /*  40 */   "setz", "setnz", "setg", "setle", "setge",
         /*  45 */   "setl", "seta", "setbe", "setae", "setb",
         /*  50 */   "not", "neg", "push", "pop", "call",
-        /*  55 */   "test", "ret", "inc", "dec"
+        /*  55 */   "test", "ret", "inc", "dec", "jmp",
+        /*  60 */   "rep movsq", "mul", "imul", "cmovz", "cmovnz",
+        /*  65 */   "cmovg", "cmovle", "cmovge", "cmovl", "cmova",
+        /*  70 */   "cmovbe", "cmovae", "cmovb"
 };
 
 #define NR_INSNS (sizeof(insns)/sizeof(*insns))
 
-/* handle the synthetic instructon I_BLKCPY. for now, always invokes the
-   'blkcpy' library function. should be modified to inline small copies. */
-
-static void
-blkcpy(struct insn * insn)
-{
-    blkcpy_used = 1;
-
-    output(" lea rax, qword %O ; blkcpy\n", insn->operand[0]);
-    output(" lea rdx, qword %O\n", insn->operand[1]);
-    output(" mov ecx, %d\n", size_of(insn->operand[0]->type));
-    output(" call blkcpy");
-}
-
 /* output a block. the main task of this function is to output the 
    instructions -- a simple task. the debugging data is most of the work! */
 
@@ -364,33 +367,53 @@ output_block(struct block * block)
 
         output("\n; %d successors:", block->nr_successors);
 
-        for (n = 0; cessor = block_successor(block, n); ++n) 
-            output(" %s=%d", 
-                jmps[block_successor_cc(block, n)], 
-                cessor->asm_label);
+        for (n = 0; cessor = block_successor(block, n); ++n) {
+            if (block_successor_cc(block, n) >= CC_TABLE)
+                output(" [%d]=%d", block_successor_cc(block, n) - CC_TABLE, cessor->asm_label);
+            else
+                output(" %s=%d", 
+                    jmps[block_successor_cc(block, n)], 
+                    cessor->asm_label);
+        }
     }
 
     output("\n%L:\n", block->asm_label);
 
     for (insn = block->first_insn; insn; insn = insn->next) {
 
-        if (insn->opcode == I_BLKCPY) {
-            blkcpy(insn);
-        } else {
-            if (I_IDX(insn->opcode) >= NR_INSNS) error(ERROR_INTERNAL);
-            output(" %s ", insns[I_IDX(insn->opcode)]);
+        if (I_IDX(insn->opcode) >= NR_INSNS) error(ERROR_INTERNAL);
+        output(" %s ", insns[I_IDX(insn->opcode)]);
 
-            for (i = 0; i < I_NR_OPERANDS(insn->opcode); i++) {
-                if (i) output(",");
-                output("%O", insn->operand[i]);
-            }
+        for (i = 0; i < I_NR_OPERANDS(insn->opcode); i++) {
+            if (i) output(",");
+            output("%O", insn->operand[i]);
         }
-        
+
         if ((insn->flags & INSN_FLAG_CC) && g_flag) output(" ; FLAG_CC");
         output("\n");
     }
 }
 
+/* output the jump table for a block that ends in an indirect I_JMP. */
+
+static void
+output_table(struct block * block)
+{
+    struct block * successor;
+    int            i;
+    int            n;
+
+    output(" .align 8\n%G:\n", block->table);
+
+    for (i = 0; i < block->nr_successors; ++i) {
+        for (n = 0; successor = block_successor(block, n); ++n) 
+            if (block_successor_cc(block, n) == CC_TABLE + i) break;
+
+        if (successor == NULL) error(ERROR_INTERNAL);
+        output(" .qword %L\n", successor->asm_label);
+    }
+}
+
 /* called after the code generator is complete, to output all the function blocks.
    the main task of this function is to glue the successive blocks together with
    appropriate jump instructions, which is surprisingly tedious. */
@@ -414,10 +437,16 @@ output_function(void)
         successor1 = block_successor(block, 0);
         if (successor1) cc1 = block_successor_cc(block, 0);
 
-        /* there's no glue if there aren't any successors (exit block) */
+        /* there's no glue if there aren't any successors (exit block),
+           and the jump table is the glue for an indirect jump */
 
         if (!successor1) continue;
 
+        if (block->table) {
+            output_table(block);
+            continue;
+        }
+
         /* if there's only one successor, it should be unconditional,
            so emit a jump unless the target is being output next. */
     
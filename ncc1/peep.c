@@ -23,6 +23,7 @@
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include "ncc1.h"
+#include "peeptab.h"
 
 /* return non-zero if 't1' and 't2' are the "same" operand. err on
    the side of caution; false negatives are OK, false positives not. 
@@ -42,6 +43,34 @@ peep_same(struct tree * t1, struct tree * t2)
     return 0;
 }
 
+/* are the CCs dead after 'insn'? they are if they're set again before 
+   anyone uses them. they're consumed only in the block in which they're
+   set, and then only by the branch at the end if there's a choice. */
+
+static int
+ccs_dead(struct block * block, struct insn * insn)
+{
+    for (insn = insn->next; insn; insn = insn->next) {
+        if (insn->opcode & I_USE_CC) return 0;
+        if (insn->opcode & I_DEF_CC) return 1;
+    }
+
+    return (block->nr_successors < 2);
+}
+
+/* if 'value' is a power of two greater than 1, return its 
+   base-2 logarithm. otherwise, return -1. */
+
+static int
+log2_con(long value)
+{
+    int n;
+
+    if ((value < 2) || (value & (value - 1))) return -1;
+    for (n = 0; value > 1; value >>= 1) ++n;
+    return n;
+}
+
 /* return non-zero if the sequence starting at 'insn' in 'block'
    matches the template 'pm', zero otherwise. */
 
@@ -62,8 +91,9 @@ peep_match(struct block * block, struct insn * insn, struct peep_match * pm)
         if (insn == NULL) return 0; 
         if ((pm[i].opcode != I_ANY) && (pm[i].opcode != insn->opcode)) return 0;
         if ((pmis & PMI_CCS_UNUSED) && (insn->flags & INSN_FLAG_CC)) return 0;
+        if ((pmis & PMI_CCS_DEAD) && !ccs_dead(block, insn)) return 0;
 
-        for (j = 0; ts = pm[i].operand[j].ts; ++j) {
+        for (j = 0; (j < NR_INSN_OPERANDS) && (ts = pm[i].operand[j].ts); ++j) {
             pmos = pm[i].operand[j].pmos;
             operand = insn->operand[j];
             if (operand == NULL) return 0; 
@@ -87,6 +117,7 @@ peep_match(struct block * block, struct insn * insn, struct peep_match * pm)
             if (pmos & PMO_CON) {
                 if (operand->op != E_CON) return 0;
                 if ((pmos & PMO_VALUE) && (operand->u.con.i != pm[i].operand[j].value)) return 0;
+                if ((pmos & PMO_POW2) && (log2_con(operand->u.con.i) < 0)) return 0;
             }
 
             if (pmos & PMO_SAME) {
@@ -100,3 +131,69 @@ peep_match(struct block * block, struct insn * insn, struct peep_match * pm)
     return 1;
 }
 
+
+/* replace the insns just matched by 'rule' with its replacement. 
+   returns the insn following the replaced sequence. */
+
+static struct insn *
+peep_replace(struct block * block, struct peep_rule * rule)
+{
+    struct peep_template * pt;
+    struct peep_match    * pm = rule->match;
+    struct tree          * operand[NR_INSN_OPERANDS];
+    struct insn          * next;
+    int                    i;
+    int                    n;
+
+    for (n = 0; pm[n].opcode != I_NONE; ++n) ;
+    next = pm[n - 1].tmp->next;
+
+    for (pt = rule->replace; pt->opcode != I_NONE; ++pt) {
+        for (i = 0; i < NR_INSN_OPERANDS; ++i) {
+            operand[i] = NULL;
+            if (pt->operand[i].ptos == 0) continue;
+            operand[i] = copy_tree(pm[pt->operand[i].insn].tmp->operand[pt->operand[i].operand]);
+            if (pt->operand[i].ptos == PTO_LOG2) operand[i]->u.con.i = log2_con(operand[i]->u.con.i);
+        }
+
+        put_insn(block, new_insn(pt->opcode, operand[0], operand[1], operand[2]), pm[0].tmp);
+    }
+
+    for (i = 0; i < n; ++i) kill_insn(block, pm[i].tmp);
+
+    return next;
+}
+
+/* apply the rules for 'phase' to 'block', returning the number of 
+   replacements made. the index limits the search to the rules that 
+   begin with the opcode at hand. PEEP_OPT stops at the first match, 
+   since the caller must recompute the data flow information. */
+
+int
+peep(struct block * block, int phase)
+{
+    struct peep_rule * rule;
+    struct insn      * insn;
+    struct insn      * next;
+    int              * index;
+    int                changes = 0;
+
+    for (insn = block->first_insn; insn; insn = next) {
+        next = insn->next;
+
+        for (index = peep_index(insn->opcode); *index >= 0; ++index) {
+            rule = &peep_rules[*index];
+            if (rule->phase != phase) continue;
+            if (!peep_match(block, insn, rule->match)) continue;
+
+            next = peep_replace(block, rule);
+            ++rule->hits;
+            ++changes;
+            break;
+        }
+
+        if (changes && (phase == PEEP_OPT)) break;
+    }
+
+    return changes;
+}
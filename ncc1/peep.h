@@ -29,6 +29,7 @@
    the encoding of PMO_SAME_AS() will have to be changed. */
 
 #define PMI_CCS_UNUSED      0x00000001      /* CCs (if any) from this insn aren't used */
+#define PMI_CCS_DEAD        0x00000002      /* no one looks at the CCs after this insn */
 
 #define PMO_REG             0x00000001      /* is E_REG */
 #define PMO_DEAD            0x00000002      /* E_REG is dead */
@@ -39,12 +40,13 @@
 #define PMO_UNALIASED       0x00000040      /* E_REG is not aliased */
 #define PMO_CON             0x00000080      /* is E_CON */
 #define PMO_VALUE           0x00000100      /* u.con.i == value */
+#define PMO_POW2            0x00000200      /* u.con.i is a power of two (> 1) */
 
     /* operand must be the same as operand 'j' of insn 'i' in the sequence.
        these can only be used to refer to the current or previous insns in
        the sequence, because of the way peep_match() works. */
 
-#define PMO_SAME_AS(i,j)    (PMO_SAME | PMO_SAME_PUT_INSN(i) | PMO_SAME_PUT_OPERAND(i))
+#define PMO_SAME_AS(i,j)    (PMO_SAME | PMO_SAME_PUT_INSN(i) | PMO_SAME_PUT_OPERAND(j))
 
     /* encoding/decoding helpers for PMO_SAME_AS(). for now, pmo[31] = flag,
        pmo[30:29] = operand index, pmo[28:26] = insn index. note that if sequences 
@@ -75,3 +77,37 @@ struct peep_match
     struct insn * tmp;
 };
 
+
+/* an array of 'struct peep_template' describes the insns that replace a
+   matched sequence, terminated with an 'opcode' of I_NONE. each operand 
+   is a copy of an operand of one of the matched insns. */
+
+#define PTO_OPERAND         1       /* copy of operand 'operand' of match 'insn' */
+#define PTO_LOG2            2       /* same, but E_CON value replaced by its log2 */
+
+struct peep_template
+{
+    int opcode;     /* I_* from block.h */
+
+    struct
+    {
+        int ptos;       /* PTO_* (or 0, if operand unused) */
+        int insn;       
+        int operand;
+    } operand[NR_INSN_OPERANDS];
+};
+
+/* the peephole rules are written in peep.rules, and compiled by peepgen 
+   into 'peep_rules[]' and an index by first opcode, in peeptab.h. */
+
+#define PEEP_OPT            0       /* applied by peeps() [opt.c] */
+#define PEEP_SUBS           1       /* applied by subs() [opt.c] */
+
+struct peep_rule
+{
+    char                 * name;
+    int                    phase;   /* PEEP_* */
+    struct peep_match    * match;
+    struct peep_template * replace;
+    int                    hits;    /* for -v */
+};
@@ -0,0 +1,509 @@
+/* Copyright (c) 2018 Charles E. Youse (charles@gnuless.org). 
+   All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+/* peepgen compiles the peephole rules in peep.rules into the tables in 
+   peeptab.h, which is included by peep.c. it runs at build time only.
+
+        peepgen peep.rules peeptab.h
+
+   the rule file is line-oriented; '#' begins a comment. a rule is
+
+        rule <name> <phase>
+        <match>
+        ...
+        => <replacement>
+        <replacement>
+        ...
+
+   where <phase> is 'opt' (applied by peeps() during optimization) or 
+   'subs' (applied by subs() just before register allocation). each 
+   <match> matches one insn, and is written as
+
+        OPCODE[(flag, ...)] <operand>, <operand>, ...
+
+   OPCODE is an I_* opcode without the prefix, or 'ANY'. the flags are
+   'ccs_unused' (the insn's CCs aren't examined) and 'ccs_dead' (nobody 
+   examines the CCs after the insn). each <operand> is a list of words:
+
+        scalar, integral, int, ...  operand type (T_IS_*), or 'ptr'; any
+                                    number may be given, joined with '|'
+        *                           any operand at all
+        reg, con                    operand is E_REG or E_CON
+        dead, def, use, notdef,     register properties (see PMO_* in
+        notuse, unaliased           peep.h)
+        =<value>                    constant with the given value
+        pow2                        constant that's a power of two (> 1)
+        same(i.j)                   same as operand 'j' of match 'i'
+
+   trailing operands may be omitted, in which case they're not checked.
+   the matched insns are replaced by the replacement insns, which may
+   be none. each is an OPCODE followed by operands, which are 
+
+        $i.j                        a copy of operand 'j' of match 'i'
+        log2($i.j)                  ... with its (constant) value replaced 
+                                    by its base-2 logarithm  
+
+   rules are tried in the order they appear in the file. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#define MAX_LINE        256
+#define MAX_RULES       256
+#define MAX_INSNS       8           /* per match or replacement */
+#define MAX_OPERANDS    3           /* must match NR_INSN_OPERANDS */
+
+struct operand
+{
+    char ts[MAX_LINE];              /* C expression for each */
+    char pmos[MAX_LINE];
+    long value;
+};
+
+struct insn
+{
+    char           opcode[MAX_LINE];
+    char           flags[MAX_LINE];
+    int            nr_operands;
+    struct operand operand[MAX_OPERANDS];
+};
+
+struct rule
+{
+    char        name[MAX_LINE];
+    char        phase[MAX_LINE];
+    int         nr_match;
+    struct insn match[MAX_INSNS];
+    int         nr_replace;
+    struct insn replace[MAX_INSNS];
+};
+
+static struct rule rules[MAX_RULES];
+static int         nr_rules;
+
+static char * in_path;
+static char * out_path;
+static int    line_number;
+
+static void
+error(char * fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "peepgen: ");
+    if (line_number) fprintf(stderr, "'%s' (%d): ", in_path, line_number);
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    if (out_path) remove(out_path);
+    exit(1);
+}
+
+/* append 'word' to the C expression 'expr', joined by " | ". */
+
+static void
+add(char * expr, char * word)
+{
+    if (strlen(expr) + strlen(word) + 4 >= MAX_LINE) error("line too complex");
+    if (*expr) strcat(expr, " | ");
+    strcat(expr, word);
+}
+
+/* the operand types recognized in match operands */
+
+static struct 
+{
+    char * word;
+    char * ts;
+} types[] = {
+    { "scalar",     "T_IS_SCALAR" },
+    { "arith",      "T_IS_ARITH" },
+    { "integral",   "T_IS_INTEGRAL" },
+    { "signed",     "T_IS_SIGNED" },
+    { "unsigned",   "T_IS_UNSIGNED" },
+    { "float",      "T_IS_FLOAT" },
+    { "char",       "T_IS_CHAR" },
+    { "short",      "T_IS_SHORT" },
+    { "int",        "T_IS_INT" },
+    { "long",       "T_IS_LONG" },
+    { "byte",       "T_IS_BYTE" },
+    { "word",       "T_IS_WORD" },
+    { "dword",      "T_IS_DWORD" },
+    { "qword",      "T_IS_QWORD" },
+    { "ptr",        "T_PTR" },
+    { NULL }
+};
+
+static struct
+{
+    char * word;
+    char * pmos;
+} pmos[] = {
+    { "reg",        "PMO_REG" },
+    { "dead",       "PMO_REG | PMO_DEAD" },
+    { "def",        "PMO_REG | PMO_DEF" },
+    { "use",        "PMO_REG | PMO_USE" },
+    { "notdef",     "PMO_REG | PMO_NOTDEF" },
+    { "notuse",     "PMO_REG | PMO_NOTUSE" },
+    { "unaliased",  "PMO_REG | PMO_UNALIASED" },
+    { "con",        "PMO_CON" },
+    { "pow2",       "PMO_CON | PMO_POW2" },
+    { NULL }
+};
+
+static struct
+{
+    char * word;
+    char * pmis;
+} pmis[] = {
+    { "ccs_unused", "PMI_CCS_UNUSED" },
+    { "ccs_dead",   "PMI_CCS_DEAD" },
+    { NULL }
+};
+
+/* return the next token from '*s', advancing past it, or NULL at the end 
+   of the string. a token is a run of characters not in 'delims', with 
+   surrounding whitespace removed. the returned string is modified in place. */
+
+static char *
+token(char ** s, char * delims)
+{
+    char * start;
+    char * end;
+
+    while (isspace(**s)) ++*s;
+    if (**s == 0) return NULL;
+    start = *s;
+    while (**s && !strchr(delims, **s)) ++*s;
+    end = *s;
+    if (**s) ++*s;
+    while ((end > start) && isspace(end[-1])) --end;
+    *end = 0;
+
+    return start;
+}
+
+/* parse an operand reference "i.j" into 'insn' and 'operand', 
+   validating against the 'nr_match' insns of the match. */
+
+static void
+reference(char * s, int nr_match, int * insn, int * operand)
+{
+    char c;
+
+    if (sscanf(s, "%d.%d%c", insn, operand, &c) != 2) error("bad operand reference '%s'", s);
+    if ((*insn < 0) || (*insn >= nr_match)) error("no such match in '%s'", s);
+    if ((*operand < 0) || (*operand >= MAX_OPERANDS)) error("no such operand in '%s'", s);
+}
+
+static void
+match_operand(struct rule * rule, struct operand * operand, char * s)
+{
+    char   buf[MAX_LINE];
+    char * word;
+    int    insn;
+    int    j;
+    int    i;
+
+    while (word = token(&s, " \t|")) {
+        for (i = 0; types[i].word && strcmp(word, types[i].word); ++i) ;
+
+        if (types[i].word) {
+            add(operand->ts, types[i].ts);
+            continue;
+        }
+
+        for (i = 0; pmos[i].word && strcmp(word, pmos[i].word); ++i) ;
+
+        if (pmos[i].word) 
+            add(operand->pmos, pmos[i].pmos);
+        else if (!strcmp(word, "*"))
+            add(operand->ts, "~0");
+        else if (word[0] == '=') {
+            operand->value = strtol(word + 1, NULL, 0);
+            add(operand->pmos, "PMO_CON | PMO_VALUE");
+        } else if (!strncmp(word, "same(", 5) && (word[strlen(word) - 1] == ')')) {
+            word[strlen(word) - 1] = 0;
+            reference(word + 5, rule->nr_match + 1, &insn, &j);
+            sprintf(buf, "PMO_SAME_AS(%d, %d)", insn, j);
+            add(operand->pmos, buf);
+        } else
+            error("unknown operand attribute '%s'", word);
+    }
+
+    if (operand->ts[0] == 0) strcpy(operand->ts, "~0");
+    if (operand->pmos[0] == 0) strcpy(operand->pmos, "0");
+}
+
+static void
+replace_operand(struct rule * rule, struct operand * operand, char * s)
+{
+    int insn;
+    int j;
+
+    if (!strncmp(s, "log2($", 6) && (s[strlen(s) - 1] == ')')) {
+        s[strlen(s) - 1] = 0;
+        strcpy(operand->pmos, "PTO_LOG2");
+        s += 6;
+    } else if (*s == '$') {
+        strcpy(operand->pmos, "PTO_OPERAND");
+        s++;
+    } else
+        error("bad replacement operand '%s'", s);
+
+    reference(s, rule->nr_match, &insn, &j);
+    sprintf(operand->ts, "%d, %d", insn, j);
+}
+
+/* parse an insn (match or replacement, according to 'replace') from 's' */
+
+static void
+insn(struct rule * rule, char * s, int replace)
+{
+    struct insn * insn;
+    char        * opcode;
+    char        * flags;
+    char        * flag;
+    char        * operand;
+    int           i;
+
+    if (replace) {
+        if (rule->nr_replace == MAX_INSNS) error("too many replacement insns");
+        insn = &rule->replace[rule->nr_replace];
+    } else {
+        if (rule->nr_replace) error("match follows replacement");
+        if (rule->nr_match == MAX_INSNS) error("too many insns in match");
+        insn = &rule->match[rule->nr_match];
+    }
+
+    opcode = s;
+    while (isupper(*s) || isdigit(*s) || (*s == '_')) ++s;
+    if (!isupper(*opcode) || (*s && !isspace(*s) && (*s != '('))) error("bad opcode");
+    sprintf(insn->opcode, "I_%.*s", (int) (s - opcode), opcode);
+    while (isspace(*s)) ++s;
+
+    if (*s == '(') {
+        if (replace) error("replacements don't take flags");
+        flags = ++s;
+        while (*s && (*s != ')')) ++s;
+        if (*s == 0) error("missing ')'");
+        *s++ = 0;
+
+        while (flag = token(&flags, ",")) {
+            for (i = 0; pmis[i].word && strcmp(flag, pmis[i].word); ++i) ;
+            if (pmis[i].word == NULL) error("unknown insn flag '%s'", flag);
+            add(insn->flags, pmis[i].pmis);
+        }
+    }
+
+    if (insn->flags[0] == 0) strcpy(insn->flags, "0");
+
+    while (operand = token(&s, ",")) {
+        if (insn->nr_operands == MAX_OPERANDS) error("too many operands");
+
+        if (replace) 
+            replace_operand(rule, &insn->operand[insn->nr_operands], operand);
+        else
+            match_operand(rule, &insn->operand[insn->nr_operands], operand);
+
+        insn->nr_operands++;
+    }
+
+    if (replace) 
+        rule->nr_replace++;
+    else
+        rule->nr_match++;
+}
+
+static void
+input(void)
+{
+    char          line[MAX_LINE];
+    struct rule * rule = NULL;
+    FILE        * fp;
+    char        * s;
+    char        * name;
+    char        * phase;
+    int           replace = 0;
+
+    fp = fopen(in_path, "r");
+    if (fp == NULL) error("can't open '%s'", in_path);
+
+    while (fgets(line, sizeof(line), fp)) {
+        ++line_number;
+        if (strchr(line, '\n') == NULL) error("line too long");
+        if (s = strchr(line, '#')) *s = 0;
+        s = line;
+        while (isspace(*s)) ++s;
+        if (*s == 0) continue;
+
+        if (!strncmp(s, "rule", 4) && isspace(s[4])) {
+            if (rule && (rule->nr_match == 0)) error("rule '%s' is empty", rule->name);
+            if (rule && !replace) error("rule '%s' has no replacement", rule->name);
+            if (nr_rules == MAX_RULES) error("too many rules");
+            rule = &rules[nr_rules++];
+            s += 4;
+            name = token(&s, " \t");
+            phase = token(&s, " \t");
+            if ((name == NULL) || (phase == NULL) || token(&s, " \t")) error("malformed rule header");
+            if (strcmp(phase, "opt") && strcmp(phase, "subs")) error("unknown phase '%s'", phase);
+            strcpy(rule->name, name);
+            sprintf(rule->phase, "PEEP_%s", !strcmp(phase, "opt") ? "OPT" : "SUBS");
+            replace = 0;
+            continue;
+        }
+
+        if (rule == NULL) error("expected 'rule'");
+
+        if (!strncmp(s, "=>", 2)) {
+            if (replace) error("duplicate '=>'");
+            if (rule->nr_match == 0) error("'=>' without match");
+            replace = 1;
+            s += 2;
+            while (isspace(*s)) ++s;
+            if (*s == 0) continue;
+        }
+
+        insn(rule, s, replace);
+    }
+
+    line_number = 0;
+    if (rule && !replace) error("rule '%s' has no replacement", rule->name);
+    fclose(fp);
+}
+
+static void
+output(void)
+{
+    FILE * fp;
+    char * seen[MAX_RULES];
+    int    nr_seen = 0;
+    int    i;
+    int    j;
+    int    k;
+
+    fp = fopen(out_path, "w");
+    if (fp == NULL) error("can't create '%s'", out_path);
+
+    fprintf(fp, "/* generated by peepgen from %s. do not edit. */\n", in_path);
+
+    for (i = 0; i < nr_rules; ++i) {
+        fprintf(fp, "\n/* %s */\n\nstatic struct peep_match peep_match%d[] =\n{\n", rules[i].name, i);
+
+        for (j = 0; j < rules[i].nr_match; ++j) {
+            fprintf(fp, "    { %s, %s, {", rules[i].match[j].opcode, rules[i].match[j].flags);
+
+            for (k = 0; k < rules[i].match[j].nr_operands; ++k) {
+                fprintf(fp, "%s { %s, %s, %ldL }", k ? "," : "",
+                        rules[i].match[j].operand[k].ts, 
+                        rules[i].match[j].operand[k].pmos,
+                        rules[i].match[j].operand[k].value);
+            }
+
+            fprintf(fp, " } },\n");
+        }
+
+        fprintf(fp, "    { I_NONE }\n};\n\nstatic struct peep_template peep_replace%d[] =\n{\n", i);
+
+        for (j = 0; j < rules[i].nr_replace; ++j) {
+            fprintf(fp, "    { %s, {", rules[i].replace[j].opcode);
+
+            for (k = 0; k < rules[i].replace[j].nr_operands; ++k) {
+                fprintf(fp, "%s { %s, %s }", k ? "," : "",
+                        rules[i].replace[j].operand[k].pmos, 
+                        rules[i].replace[j].operand[k].ts);
+            }
+
+            fprintf(fp, " } },\n");
+        }
+
+        fprintf(fp, "    { I_NONE }\n};\n");
+    }
+
+    fprintf(fp, "\nstruct peep_rule peep_rules[] =\n{\n");
+
+    for (i = 0; i < nr_rules; ++i) 
+        fprintf(fp, "    { \"%s\", %s, peep_match%d, peep_replace%d },\n", 
+                rules[i].name, rules[i].phase, i, i);
+
+    fprintf(fp, "    { NULL }\n};\n\nint nr_peep_rules = %d;\n", nr_rules);
+
+    /* the index: for each opcode that begins a rule, the list of 
+       those rules, in order, terminated by -1. I_ANY matches begin
+       every list, in file order with the rest. */
+
+    for (i = 0; i < nr_rules; ++i) {
+        for (j = 0; j < nr_seen; ++j) if (!strcmp(seen[j], rules[i].match[0].opcode)) break;
+        if (j < nr_seen) continue;
+        if (!strcmp(rules[i].match[0].opcode, "I_ANY")) continue;
+        seen[nr_seen++] = rules[i].match[0].opcode;
+        fprintf(fp, "\nstatic int peep_index%d[] = {", nr_seen - 1);
+
+        for (j = 0; j < nr_rules; ++j) 
+            if (    !strcmp(rules[j].match[0].opcode, seen[nr_seen - 1]) 
+                ||  !strcmp(rules[j].match[0].opcode, "I_ANY")  )
+            {
+                fprintf(fp, " %d,", j);
+            }
+
+        fprintf(fp, " -1 };\n");
+    }
+
+    fprintf(fp, "\nstatic int peep_index_any[] = {");
+
+    for (j = 0; j < nr_rules; ++j) 
+        if (!strcmp(rules[j].match[0].opcode, "I_ANY")) fprintf(fp, " %d,", j);
+
+    fprintf(fp, " -1 };\n\nstatic int *\npeep_index(int opcode)\n{\n    switch (I_IDX(opcode))\n    {\n");
+
+    for (j = 0; j < nr_seen; ++j) 
+        fprintf(fp, "    case I_IDX(%s): return peep_index%d;\n", seen[j], j);
+
+    fprintf(fp, "    default: return peep_index_any;\n    }\n}\n");
+
+    if (ferror(fp)) error("error writing '%s'", out_path);
+    fclose(fp);
+}
+
+int
+main(int argc, char * argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: peepgen <rules> <output>\n");
+        exit(1);
+    }
+
+    in_path = argv[1];
+    input();
+    out_path = argv[2];
+    output();
+    return 0;
+}
@@ -0,0 +1,295 @@
+/* generated by peepgen from peep.rules. do not edit. */
+
+/* and_test */
+
+static struct peep_match peep_match0[] =
+{
+    { I_AND, 0, { { T_IS_SCALAR, PMO_REG | PMO_DEAD, 0L }, { ~0, 0, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace0[] =
+{
+    { I_TEST, { { PTO_OPERAND, 0, 0 }, { PTO_OPERAND, 0, 1 } } },
+    { I_NONE }
+};
+
+/* add_inc */
+
+static struct peep_match peep_match1[] =
+{
+    { I_ADD, PMI_CCS_UNUSED, { { T_IS_SCALAR, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace1[] =
+{
+    { I_INC, { { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* sub_inc */
+
+static struct peep_match peep_match2[] =
+{
+    { I_SUB, PMI_CCS_UNUSED, { { T_IS_SCALAR, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, -1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace2[] =
+{
+    { I_INC, { { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* sub_dec */
+
+static struct peep_match peep_match3[] =
+{
+    { I_SUB, PMI_CCS_UNUSED, { { T_IS_SCALAR, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace3[] =
+{
+    { I_DEC, { { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* add_dec */
+
+static struct peep_match peep_match4[] =
+{
+    { I_ADD, PMI_CCS_UNUSED, { { T_IS_SCALAR, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, -1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace4[] =
+{
+    { I_DEC, { { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* imul_shl */
+
+static struct peep_match peep_match5[] =
+{
+    { I_IMUL, PMI_CCS_UNUSED, { { T_IS_INTEGRAL, 0, 0L }, { ~0, PMO_CON | PMO_POW2, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace5[] =
+{
+    { I_SHL, { { PTO_OPERAND, 0, 0 }, { PTO_LOG2, 0, 1 } } },
+    { I_NONE }
+};
+
+/* imul_neg */
+
+static struct peep_match peep_match6[] =
+{
+    { I_IMUL, PMI_CCS_UNUSED, { { T_IS_INTEGRAL, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, -1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace6[] =
+{
+    { I_NEG, { { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* mov_xor */
+
+static struct peep_match peep_match7[] =
+{
+    { I_MOV, PMI_CCS_DEAD, { { T_IS_INTEGRAL | T_PTR, PMO_REG, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace7[] =
+{
+    { I_XOR, { { PTO_OPERAND, 0, 0 }, { PTO_OPERAND, 0, 0 } } },
+    { I_NONE }
+};
+
+/* add_0 */
+
+static struct peep_match peep_match8[] =
+{
+    { I_ADD, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace8[] =
+{
+    { I_NONE }
+};
+
+/* sub_0 */
+
+static struct peep_match peep_match9[] =
+{
+    { I_SUB, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace9[] =
+{
+    { I_NONE }
+};
+
+/* or_0 */
+
+static struct peep_match peep_match10[] =
+{
+    { I_OR, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace10[] =
+{
+    { I_NONE }
+};
+
+/* xor_0 */
+
+static struct peep_match peep_match11[] =
+{
+    { I_XOR, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace11[] =
+{
+    { I_NONE }
+};
+
+/* and_1s */
+
+static struct peep_match peep_match12[] =
+{
+    { I_AND, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, -1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace12[] =
+{
+    { I_NONE }
+};
+
+/* imul_1 */
+
+static struct peep_match peep_match13[] =
+{
+    { I_IMUL, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 1L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace13[] =
+{
+    { I_NONE }
+};
+
+/* shl_0 */
+
+static struct peep_match peep_match14[] =
+{
+    { I_SHL, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace14[] =
+{
+    { I_NONE }
+};
+
+/* shr_0 */
+
+static struct peep_match peep_match15[] =
+{
+    { I_SHR, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace15[] =
+{
+    { I_NONE }
+};
+
+/* sar_0 */
+
+static struct peep_match peep_match16[] =
+{
+    { I_SAR, PMI_CCS_UNUSED, { { T_IS_QWORD, 0, 0L }, { ~0, PMO_CON | PMO_VALUE, 0L } } },
+    { I_NONE }
+};
+
+static struct peep_template peep_replace16[] =
+{
+    { I_NONE }
+};
+
+struct peep_rule peep_rules[] =
+{
+    { "and_test", PEEP_OPT, peep_match0, peep_replace0 },
+    { "add_inc", PEEP_SUBS, peep_match1, peep_replace1 },
+    { "sub_inc", PEEP_SUBS, peep_match2, peep_replace2 },
+    { "sub_dec", PEEP_SUBS, peep_match3, peep_replace3 },
+    { "add_dec", PEEP_SUBS, peep_match4, peep_replace4 },
+    { "imul_shl", PEEP_SUBS, peep_match5, peep_replace5 },
+    { "imul_neg", PEEP_SUBS, peep_match6, peep_replace6 },
+    { "mov_xor", PEEP_SUBS, peep_match7, peep_replace7 },
+    { "add_0", PEEP_SUBS, peep_match8, peep_replace8 },
+    { "sub_0", PEEP_SUBS, peep_match9, peep_replace9 },
+    { "or_0", PEEP_SUBS, peep_match10, peep_replace10 },
+    { "xor_0", PEEP_SUBS, peep_match11, peep_replace11 },
+    { "and_1s", PEEP_SUBS, peep_match12, peep_replace12 },
+    { "imul_1", PEEP_SUBS, peep_match13, peep_replace13 },
+    { "shl_0", PEEP_SUBS, peep_match14, peep_replace14 },
+    { "shr_0", PEEP_SUBS, peep_match15, peep_replace15 },
+    { "sar_0", PEEP_SUBS, peep_match16, peep_replace16 },
+    { NULL }
+};
+
+int nr_peep_rules = 17;
+
+static int peep_index0[] = { 0, 12, -1 };
+
+static int peep_index1[] = { 1, 4, 8, -1 };
+
+static int peep_index2[] = { 2, 3, 9, -1 };
+
+static int peep_index3[] = { 5, 6, 13, -1 };
+
+static int peep_index4[] = { 7, -1 };
+
+static int peep_index5[] = { 10, -1 };
+
+static int peep_index6[] = { 11, -1 };
+
+static int peep_index7[] = { 14, -1 };
+
+static int peep_index8[] = { 15, -1 };
+
+static int peep_index9[] = { 16, -1 };
+
+static int peep_index_any[] = { -1 };
+
+static int *
+peep_index(int opcode)
+{
+    switch (I_IDX(opcode))
+    {
+    case I_IDX(I_AND): return peep_index0;
+    case I_IDX(I_ADD): return peep_index1;
+    case I_IDX(I_SUB): return peep_index2;
+    case I_IDX(I_IMUL): return peep_index3;
+    case I_IDX(I_MOV): return peep_index4;
+    case I_IDX(I_OR): return peep_index5;
+    case I_IDX(I_XOR): return peep_index6;
+    case I_IDX(I_SHL): return peep_index7;
+    case I_IDX(I_SHR): return peep_index8;
+    case I_IDX(I_SAR): return peep_index9;
+    default: return peep_index_any;
+    }
+}
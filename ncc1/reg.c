@@ -22,6 +22,7 @@
  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
+#include <stdlib.h>
 #include <string.h>
 #include "ncc1.h"
 
@@ -142,6 +143,215 @@ cull(struct block * block, int n, struct symbol * regs[])
     }
 }
 
+/* the global allocator. unless -l is given, when optimizing we first run
+   a linear scan over the whole function to pick one register for each
+   variable that lives across blocks. its choices are imposed on the blocks
+   by precolor() before select_regs() gets to them, so a variable doesn't
+   change registers from block to block and reconcile() has nothing to do
+   on its edges. whatever doesn't get a register (and all the temporaries)
+   is left to the block allocator, which works around the assignments.
+
+   each block occupies a range of positions in the (sequenced) block list,
+   and a variable's interval spans all the blocks in which it's live. we
+   don't try to track holes, nor the exact positions within blocks, since
+   select_regs() must give the variable the same register for the whole
+   of every block in which it's live anyway. */
+
+struct interval
+{
+    struct symbol * symbol;
+    int             start;      /* first position .. */
+    int             end;        /* .. and last */
+    int             weight;     /* spill cost, weighted by loop depth */
+    int             prohibit;   /* registers (1 << R_IDX(x)) not allowed */
+    int             reg;        /* assigned real register or R_NONE */
+};
+
+static struct interval * intervals;
+static int               nr_intervals;
+
+/* each reference is worth 8 times as much as one a loop level further out.
+   the depth is capped to keep the weights in range. */
+
+#define LOOP_WEIGHT(b)      (1 << (3 * MIN((b)->loop_level, 6)))
+
+static int
+interval_cmp_reg(const void * v1, const void * v2)
+{
+    const struct interval * i1 = v1;
+    const struct interval * i2 = v2;
+
+    return (i1->symbol->reg > i2->symbol->reg) - (i1->symbol->reg < i2->symbol->reg);
+}
+
+static int
+interval_cmp_start(const void * v1, const void * v2)
+{
+    const struct interval * i1 = v1;
+    const struct interval * i2 = v2;
+
+    return (i1->start > i2->start) - (i1->start < i2->start);
+}
+
+/* return the interval for the pseudo register, or NULL */
+
+static struct interval *
+find_interval(int reg)
+{
+    struct interval key;
+    struct symbol   symbol;
+
+    if (intervals == NULL) return NULL;
+    symbol.reg = reg;
+    key.symbol = &symbol;
+    return bsearch(&key, intervals, nr_intervals, sizeof(struct interval), interval_cmp_reg);
+}
+
+/* build the intervals. they're sorted by register when we're done. */
+
+static void
+build_intervals(void)
+{
+    struct block    * block;
+    struct defuse   * defuse;
+    struct insn     * insn;
+    struct interval * interval;
+    int               pos;
+    int               i;
+
+    nr_intervals = 0;
+
+    for (block = first_block; block; block = block->next) 
+        for (defuse = block->defuses; defuse; defuse = defuse->link) 
+            ++nr_intervals;
+
+    intervals = allocate(sizeof(struct interval) * (nr_intervals + 1));
+    nr_intervals = 0;
+
+    for (block = first_block, pos = 0; block; block = block->next) {
+        for (defuse = block->defuses; defuse; defuse = defuse->link) {
+            if (!(defuse->symbol->ss & S_REGISTER)) continue;
+            if (DU_TEMP(*defuse)) continue;
+
+            for (i = 0; i < nr_intervals; ++i)
+                if (intervals[i].symbol == defuse->symbol) break;
+
+            interval = &intervals[i];
+
+            if (i == nr_intervals) {
+                ++nr_intervals;
+                interval->symbol = defuse->symbol;
+                interval->start = pos;
+                interval->weight = 0;
+                interval->prohibit = (1 << R_IDX(R_BP)) | (1 << R_IDX(R_SP));
+                interval->reg = R_NONE;
+            }
+
+            interval->end = pos + block->nr_insns + 1;
+
+            if (defuse->symbol->reg & R_IS_FLOAT)
+                interval->prohibit |= block->prohibit_fregs | block->temponly_fregs;
+            else
+                interval->prohibit |= block->prohibit_iregs | block->temponly_iregs;
+        }
+
+        pos += block->nr_insns + 2;
+    }
+
+    qsort(intervals, nr_intervals, sizeof(struct interval), interval_cmp_reg);
+
+    for (block = first_block; block; block = block->next) {
+        for (insn = block->first_insn; insn; insn = insn->next) {
+            for (i = 0; (i < NR_INSN_REGS) && (insn->regs_used[i] != R_NONE); ++i) 
+                if (interval = find_interval(insn->regs_used[i]))
+                    interval->weight += LOOP_WEIGHT(block);
+
+            for (i = 0; (i < NR_INSN_REGS) && (insn->regs_defd[i] != R_NONE); ++i) 
+                if (interval = find_interval(insn->regs_defd[i]))
+                    interval->weight += LOOP_WEIGHT(block);
+        }
+    }
+}
+
+/* linear scan proper, in order of increasing start position. when no 
+   register is available, the least valuable of the current interval and
+   the active ones it could displace is left for the block allocator. */
+
+static void
+linear_scan(void)
+{
+    struct interval * current;
+    struct interval * active;
+    struct interval * victim;
+    int               used;
+    int               i;
+    int               j;
+
+    qsort(intervals, nr_intervals, sizeof(struct interval), interval_cmp_start);
+
+    for (i = 0; i < nr_intervals; ++i) {
+        current = &intervals[i];
+        victim = NULL;
+        used = 0;
+
+        for (j = 0; j < i; ++j) {
+            active = &intervals[j];
+            if (active->reg == R_NONE) continue;
+            if (active->end < current->start) continue;
+            if ((active->symbol->reg & R_IS_FLOAT) != (current->symbol->reg & R_IS_FLOAT)) continue;
+            used |= 1 << R_IDX(active->reg);
+
+            if (current->prohibit & (1 << R_IDX(active->reg))) continue;
+            if (!victim || (active->weight < victim->weight)) victim = active;
+        }
+
+        for (j = 0; j < NR_REGS; ++j) {
+            if ((used | current->prohibit) & (1 << j)) continue;
+            current->reg = j + ((current->symbol->reg & R_IS_FLOAT) ? R_XMM0 : R_AX);
+            break;
+        }
+
+        if ((current->reg == R_NONE) && victim && (victim->weight < current->weight)) {
+            current->reg = victim->reg;
+            victim->reg = R_NONE;
+        }
+    }
+
+    qsort(intervals, nr_intervals, sizeof(struct interval), interval_cmp_reg);
+}
+
+static void
+free_intervals(void)
+{
+    free(intervals);
+    intervals = NULL;
+    nr_intervals = 0;
+}
+
+/* impose the global assignments on the block's register sets,
+   displacing anything that's been inherited in their place. */
+
+static void
+precolor(struct block * block)
+{
+    struct defuse   * defuse;
+    struct interval * interval;
+    struct symbol  ** regs;
+    int               i;
+
+    for (defuse = block->defuses; defuse; defuse = defuse->link) {
+        if (DU_TEMP(*defuse)) continue;
+        interval = find_interval(defuse->symbol->reg);
+        if ((interval == NULL) || (interval->reg == R_NONE)) continue;
+        regs = (interval->reg & R_IS_FLOAT) ? block->fregs : block->iregs;
+
+        for (i = 0; i < NR_REGS; ++i) 
+            if (regs[i] == defuse->symbol) regs[i] = NULL;
+
+        regs[R_IDX(interval->reg)] = defuse->symbol;
+    }
+}
+
 /* first pass - returns non-zero on success, or zero if a split is required. */
 
 static int
@@ -163,6 +373,15 @@ select_regs(struct block * block)
     cull(block, 0, block->iregs);
     cull(block, 0, block->fregs);
 
+    /* nor can we inherit registers that are used explicitly here. */
+
+    for (n = 0; n < NR_REGS; ++n) {
+        if (block->prohibit_iregs & (1 << n)) block->iregs[n] = NULL;
+        if (block->prohibit_fregs & (1 << n)) block->fregs[n] = NULL;
+    }
+
+    precolor(block);
+
     /* the difference between the block regs and the local regs concerns
        temporaries (DU_TEMPs): they're never in the block regs. */
 
@@ -170,13 +389,18 @@ select_regs(struct block * block)
     memcpy(fregs, block->fregs, sizeof(fregs));
 
     /* first, allocate all the non-DU_TEMPS. they must have the same
-       assignment for the whole block. */
+       assignment for the whole block. variables that merely pass through
+       come last; if there's no room for them, they can wait in memory 
+       (reconcile() will take care of it), since splitting won't help. */
 
     for (defuse = block->defuses; defuse; defuse = defuse->link) {
-        if (DU_TEMP(*defuse)) continue;
+        if (DU_TEMP(*defuse) || DU_TRANSIT(*defuse)) continue;
         if (map_reg(block, defuse, iregs, fregs) == R_NONE) return 0;
     }
 
+    for (defuse = block->defuses; defuse; defuse = defuse->link) 
+        if (DU_TRANSIT(*defuse)) map_reg(block, defuse, iregs, fregs);
+
     /* iterate over instructions, allocating and culling temporaries as 
        needed. if we run out of registers, split the block and start over. */
 
@@ -233,6 +457,174 @@ spill(struct block * block, struct defuse * defuse, struct insn * before, int di
     put_insn(block, insn, before);
 }
 
+/* a simple alias analysis for the aliased variables' register caches.
+   returns non-zero if the memory operand 'mem' might overlap the home of
+   'symbol'. frame slots ([rbp+ofs]) and globals ([rip glob+ofs]) are 
+   known exactly, as is the outgoing argument area ([rsp+ofs]), which 
+   never holds a variable. indexed frame or global references can only
+   reach their own kind. anything else is through a pointer, which can
+   reach any variable (whose address must have been taken) unless 'typed'
+   is set, in which case the types must be compatible: apart from the
+   character types, which can alias anything, different kinds of scalars
+   (ignoring signedness) don't overlap. */
+
+static int
+alias_types(struct type * type1, struct type * type2)
+{
+    static int classes[] = { T_IS_SHORT, T_IS_INT, T_IS_LONG, T_PTR, T_FLOAT, T_DOUBLE | T_LDOUBLE };
+    int        i;
+
+    if (!(type1->ts & T_IS_SCALAR) || !(type2->ts & T_IS_SCALAR)) return 1;
+    if ((type1->ts | type2->ts) & T_IS_CHAR) return 1;
+
+    for (i = 0; i < sizeof(classes) / sizeof(*classes); ++i) 
+        if ((type1->ts & classes[i]) && (type2->ts & classes[i])) return 1;
+
+    return 0;
+}
+
+static int
+may_alias(struct tree * mem, struct symbol * symbol, int typed)
+{
+    struct tree * home;
+    int           alias;
+
+    home = memory_tree(symbol);
+
+    if (mem->u.mi.rip) 
+        alias = home->u.mi.rip && (mem->u.mi.glob == home->u.mi.glob);
+    else if (mem->u.mi.glob) 
+        alias = (mem->u.mi.glob == home->u.mi.glob);
+    else if ((mem->u.mi.b == R_SP) && (mem->u.mi.i == R_NONE))
+        alias = 0;
+    else if (mem->u.mi.b == R_BP) {
+        alias = (home->u.mi.b == R_BP);
+
+        if (alias && (mem->u.mi.i == R_NONE))
+            alias = (mem->u.mi.ofs < home->u.mi.ofs + size_of(home->type))
+                 && (home->u.mi.ofs < mem->u.mi.ofs + size_of(mem->type));
+    } else 
+        alias = !typed || alias_types(mem->type, symbol->type);
+
+    free_tree(home);
+    return alias;
+}
+
+/* returns non-zero if 'insn' writes (if 'def' is set) or reads or writes
+   (if not) memory that might hold the aliased variable 'symbol'. reads
+   aren't subject to type-based disambiguation: punning through a pointer
+   cast (e.g., *((unsigned *) &f)) is too common to risk a stale value.
+   without -O, every memory access is assumed to alias every variable. */
+
+static int
+insn_aliases(struct insn * insn, struct symbol * symbol, int def)
+{
+    struct tree * operand;
+    int           i;
+
+    if (!O_flag) return def ? insn->mem_defd : (insn->mem_used || insn->mem_defd);
+    if (insn->opcode == I_CALL) return 1;
+    if (insn->opcode == I_LEA) return 0;
+    if (insn->opcode & I_DEF_MEM) return 1;
+    if (!def && (insn->opcode & I_USE_MEM)) return 1;
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        operand = insn->operand[i];
+        if (operand->op != E_MEM) continue;
+
+        if ((insn->opcode & I_DEF(i)) && may_alias(operand, symbol, 1)) return 1;
+        if (!def && (insn->opcode & I_USE(i)) && may_alias(operand, symbol, 0)) return 1;
+    }
+
+    return 0;
+}
+
+/* if 'insn' is the only reference to the aliased variable in 'defuse'
+   before its register would be reloaded anyway (i.e., before it's next 
+   DEFd or invalidated by a memory write), substitute the variable's memory 
+   for its register in 'insn', if the instruction allows it. the register's
+   contents are then INVALID. returns non-zero if the operand was folded. */
+
+static int
+fold(struct block * block, struct defuse * defuse, struct insn * insn)
+{
+    struct insn * next;
+    int           reg;
+    int           uses;
+    int           defs;
+    int           operand;
+    int           i;
+
+    reg = defuse->symbol->reg;
+    uses = insn_uses_reg(insn, reg);
+    defs = insn_defs_reg(insn, reg);
+    operand = -1;
+
+    /* a USE reads the register, so it must be INVALID or we'd be adding 
+       a memory access for nothing. a USE and DEF together (e.g., I_ADD) 
+       would write memory, so memory mustn't be out-of-date. */
+
+    if (uses && !defs && (defuse->cache != DU_CACHE_INVALID)) return 0;
+    if (uses && defs && (defuse->cache == DU_CACHE_DIRTY)) return 0;
+
+    /* the register must appear exactly once, as an operand 
+       in itself, and the instruction can't already access memory */
+
+    for (i = 0; i < I_NR_OPERANDS(insn->opcode); ++i) {
+        if (insn->operand[i]->op == E_MEM) return 0;
+
+        if ((insn->operand[i]->op == E_REG) && (insn->operand[i]->u.reg == reg)) {
+            if (operand != -1) return 0;
+            operand = i;
+        }
+    }
+
+    if (operand == -1) return 0;
+    if (!(insn->opcode & I_MEM(operand))) return 0;
+    if (size_of(insn->operand[operand]->type) != size_of(defuse->symbol->type)) return 0;
+
+    for (next = insn->next; next; next = next->next) {
+        if (insn_uses_reg(next, reg)) return 0;
+        if (insn_defs_reg(next, reg) || insn_aliases(next, defuse->symbol, 1)) break;
+    }
+
+    free_tree(insn->operand[operand]);
+    insn->operand[operand] = memory_tree(defuse->symbol);
+    defuse->cache = DU_CACHE_INVALID;
+    ++stats[STAT_FOLD];
+
+    return 1;
+}
+
+/* the cache state of an aliased variable at the start of a block. it's
+   CLEAN if it was CLEAN at the end of every predecessor, and held in the
+   same register throughout them (so the reconciliation blocks leave it
+   alone). predecessors that haven't been rewritten yet (back edges) are
+   unknown, so the variable is INVALID and will be reloaded. */
+
+static int
+inherit_cache(struct block * block, struct defuse * defuse)
+{
+    struct block   * predecessor;
+    struct defuse  * pred_defuse;
+    struct symbol ** regs;
+    int              n;
+
+    if (!O_flag || (block == entry_block) || (block->nr_predecessors == 0)) 
+        return DU_CACHE_INVALID;
+
+    for (n = 0; predecessor = block_predecessor(block, n); ++n) {
+        if (!(predecessor->bs & B_CACHE)) return DU_CACHE_INVALID;
+        regs = (defuse->reg & R_IS_FLOAT) ? predecessor->fregs : predecessor->iregs;
+        if (regs[R_IDX(defuse->reg)] != defuse->symbol) return DU_CACHE_INVALID;
+        pred_defuse = find_defuse_by_symbol(predecessor, defuse->symbol);
+        if ((pred_defuse == NULL) || (pred_defuse->reg != defuse->reg)) return DU_CACHE_INVALID;
+        if (pred_defuse->cache != DU_CACHE_CLEAN) return DU_CACHE_INVALID;
+    }
+
+    return DU_CACHE_CLEAN;
+}
+
 /* the second pass has three main responsibilities:
 
    1. to rewrite the pseudo-registers in each instruction with 
@@ -241,9 +633,9 @@ spill(struct block * block, struct defuse * defuse, struct insn * before, int di
       save/restore the callee-save registers, and
    3. insert appropriate memory accesses for aliased variables.
 
-   there's a lot of room for optimization here w/r/t #3. in particular,
-   in many cases a load or store could be fused with another instruction
-   (since AMD64 supports memory operands). TO-DO. */
+   where an aliased variable's register would only be loaded or stored
+   for the sake of a single instruction, fold() has that instruction 
+   access the variable in memory directly instead. */
 
 static void
 rewrite(struct block * block)
@@ -252,15 +644,35 @@ rewrite(struct block * block)
     struct defuse * defuse;
     int             i;
 
+    for (defuse = block->defuses; defuse; defuse = defuse->link) 
+        if ((defuse->reg != R_NONE) && !(defuse->symbol->ss & S_REGISTER))
+            defuse->cache = inherit_cache(block, defuse);
+
     for (insn = block->first_insn; insn; insn = insn->next) {
+        /* real registers DEFd explicitly (e.g., arguments with -r) 
+           must be saved too. (AX, CX, DX are weeded out later.) */
+
+        for (i = 0; (i < NR_INSN_REGS) && (insn->regs_defd[i] != R_NONE); ++i) {
+            if (R_IS_PSEUDO(insn->regs_defd[i])) continue;
+
+            if (insn->regs_defd[i] & R_IS_FLOAT)
+                save_fregs |= 1 << R_IDX(insn->regs_defd[i]);
+            else
+                save_iregs |= 1 << R_IDX(insn->regs_defd[i]);
+        }
+
         for (defuse = block->defuses; defuse; defuse = defuse->link) {
             if (defuse->reg == R_NONE) continue;
 
             if (!(defuse->symbol->ss & S_REGISTER)) {
                 /* rules for aliased variables .. */
 
-                /* before a memory read or write (or I_CALL): DIRTY -> spill -> CLEAN */
-                if ((insn->mem_used || insn->mem_defd) && (defuse->cache == DU_CACHE_DIRTY)) {
+                if (O_flag && insn_touches_reg(insn, defuse->symbol->reg) && fold(block, defuse, insn))
+                    continue;
+
+                /* before a memory read or write (or I_CALL) that might
+                   see the variable: DIRTY -> spill -> CLEAN */
+                if ((defuse->cache == DU_CACHE_DIRTY) && insn_aliases(insn, defuse->symbol, 0)) {
                     spill(block, defuse, insn, SPILL_OUT);
                     defuse->cache = DU_CACHE_CLEAN;
                 }
@@ -274,8 +686,9 @@ rewrite(struct block * block)
                 /* after the reg is DEFd, * -> DIRTY */
                 if (insn_defs_reg(insn, defuse->symbol->reg)) defuse->cache = DU_CACHE_DIRTY;
 
-                /* after a memory write (or I_CALL), * -> INVALID */
-                if (insn->mem_defd) defuse->cache = DU_CACHE_INVALID;
+                /* after a memory write (or I_CALL) that might 
+                   reach the variable, * -> INVALID */
+                if (insn_aliases(insn, defuse->symbol, 1)) defuse->cache = DU_CACHE_INVALID;
             } 
 
             /* if the register appears in this instruction, substitute
@@ -293,14 +706,18 @@ rewrite(struct block * block)
         }
     }
 
-    /* any aliased variables that are still DIRTY have to be spilled. */
+    /* any aliased variables that are still DIRTY have to be spilled. 
+       whatever's left CLEAN may be inherited by the successors. */
 
     for (defuse = block->defuses; defuse; defuse = defuse->link) {
         if (defuse->reg == R_NONE) continue;
         if (defuse->symbol->ss & S_REGISTER) continue;
         if (defuse->cache != DU_CACHE_DIRTY) continue; 
         spill(block, defuse, NULL, SPILL_OUT);
+        defuse->cache = DU_CACHE_CLEAN;
     }
+
+    block->bs |= B_CACHE;
 }
 
 /* find registers in the 'from' block that don't match 'to'.
@@ -389,6 +806,12 @@ allocate_regs(void)
   restart:
     sequence_blocks();
     compute_global_defuses();
+    free_intervals();
+
+    if (O_flag && !l_flag) {
+        build_intervals();
+        linear_scan();
+    }
 
     for (block = first_block; block; block = block->next) {
         if (!select_regs(block)) {
@@ -416,5 +839,6 @@ allocate_regs(void)
         for (n = 0; block_successor(block, n); ++n) reconcile(block, n);
     }
 
+    free_intervals();
     sequence_blocks();
 }
@@ -0,0 +1,257 @@
+/* Copyright (c) 2018 Charles E. Youse (charles@gnuless.org). 
+   All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ * Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#include "ncc1.h"
+
+/* list scheduling. the code generator emits insns in the order the tree
+   walker produces them, so a load is usually followed immediately by its
+   use. with -s, the insns of each block are reordered after register 
+   allocation to hide latencies: each insn is given a latency by a rough 
+   model, and each in turn, the one that can start soonest is chosen, 
+   preferring the one that heads the longest (latency-weighted) path to 
+   the end of the block. with -ss, this is also done before allocation, 
+   when there's more freedom (no false dependencies between values that 
+   happen to share a register), at the cost of register pressure.
+
+   blocks are scheduled in windows of at most MAX_WINDOW insns to bound
+   the cost of building the dependence graph. */
+
+#define MAX_WINDOW      64
+
+#define MEM_READ        1
+#define MEM_WRITE       2
+
+static struct insn * window[MAX_WINDOW];
+static char          deps[MAX_WINDOW][MAX_WINDOW];  /* [i][j]: i before j */
+static int           mems[MAX_WINDOW];              /* MEM_* */
+static int           latencies[MAX_WINDOW];
+static int           heights[MAX_WINDOW];
+static int           earliest[MAX_WINDOW];
+static char          scheduled[MAX_WINDOW];
+
+/* cycles until the result of 'insn' is available. loads add 4. */
+
+static int
+latency(struct insn * insn, int mem)
+{
+    int cycles;
+
+    switch (insn->opcode)
+    {
+    case I_IMUL:
+    case I_MUL:
+    case I_IMUL1:       cycles = 3; break;
+
+    case I_DIV:
+    case I_IDIV:        cycles = 25; break;
+
+    case I_ADDSS:       case I_ADDSD:
+    case I_SUBSS:       case I_SUBSD:
+    case I_MULSS:       case I_MULSD:
+    case I_CVTSS2SI:    case I_CVTSD2SI:
+    case I_CVTSI2SS:    case I_CVTSI2SD:
+    case I_CVTSS2SD:    case I_CVTSD2SS:
+                        cycles = 4; break;
+
+    case I_DIVSS:
+    case I_DIVSD:       cycles = 14; break;
+
+    default:            cycles = 1;
+    }
+
+    if (mem & MEM_READ) cycles += 4;
+    return cycles;
+}
+
+/* insns that nothing may cross: calls and string insns (which have
+   implicit register arguments), jumps, and anything that touches the 
+   stack pointer, since stack_depths() [opt.c] depends on their order. */
+
+static int
+barrier(struct insn * insn)
+{
+    if (insn->opcode & I_STRING) return 1;
+
+    switch (insn->opcode)
+    {
+    case I_CALL:
+    case I_PUSH:
+    case I_POP:
+    case I_RET:
+    case I_JMP:
+        return 1;
+    }
+
+    return insn_touches_reg(insn, R_SP);
+}
+
+/* the memory accesses of 'insn' (MEM_*). LEA doesn't really access 
+   memory. before allocation, the register of an aliased variable stands
+   for its memory as far as ordering goes, since rewrite() [reg.c] will 
+   load and store it around the other memory accesses. */
+
+static int
+memory(struct block * block, struct insn * insn)
+{
+    struct defuse * defuse;
+    int             mem = 0;
+    int             i;
+
+    if (insn->mem_used && (insn->opcode != I_LEA)) mem |= MEM_READ;
+    if (insn->mem_defd) mem |= MEM_WRITE;
+    if (block->bs & B_REG) return mem;
+
+    for (i = 0; i < NR_INSN_REGS; ++i) {
+        if (insn->regs_used[i] != R_NONE) {
+            defuse = find_defuse(block, insn->regs_used[i], FIND_DEFUSE_NORMAL);
+            if (defuse && !(defuse->symbol->ss & S_REGISTER)) mem |= MEM_READ;
+        }
+
+        if (insn->regs_defd[i] != R_NONE) {
+            defuse = find_defuse(block, insn->regs_defd[i], FIND_DEFUSE_NORMAL);
+            if (defuse && !(defuse->symbol->ss & S_REGISTER)) mem |= MEM_WRITE;
+        }
+    }
+
+    return mem;
+}
+
+/* must window[i] precede window[j] (i < j)? the condition codes are 
+   treated like a register, except that insns whose CCs aren't examined 
+   need only stay out of the way of those whose CCs are. */
+
+static int
+depends(int i, int j)
+{
+    struct insn * a = window[i];
+    struct insn * b = window[j];
+    int           k;
+
+    if (barrier(a) || barrier(b)) return 1;
+    if ((mems[i] & MEM_WRITE) && mems[j]) return 1;
+    if ((mems[j] & MEM_WRITE) && mems[i]) return 1;
+
+    for (k = 0; k < NR_INSN_REGS; ++k) {
+        if ((a->regs_defd[k] != R_NONE) && insn_touches_reg(b, a->regs_defd[k])) return 1;
+        if ((a->regs_used[k] != R_NONE) && insn_defs_reg(b, a->regs_used[k])) return 1;
+    }
+
+    if ((a->opcode & I_DEF_CC) && (b->flags & INSN_FLAG_CC)) return 1;
+    if ((a->flags & INSN_FLAG_CC) && (b->opcode & I_USE_CC)) return 1;
+    if ((a->opcode & I_USE_CC) && (b->opcode & I_DEF_CC)) return 1;
+
+    return 0;
+}
+
+/* schedule the 'n' insns in window[], which are put back into 'block'
+   before 'before' in their new order. */
+
+static void
+schedule_window(struct block * block, int n, struct insn * before)
+{
+    int cycle = 0;
+    int start;
+    int best_start;
+    int best;
+    int done;
+    int i;
+    int j;
+
+    for (i = 0; i < n; ++i) {
+        mems[i] = memory(block, window[i]);
+        latencies[i] = latency(window[i], mems[i]);
+        scheduled[i] = 0;
+        earliest[i] = 0;
+    }
+
+    for (i = 0; i < n; ++i)
+        for (j = i + 1; j < n; ++j) 
+            deps[i][j] = depends(i, j);
+
+    for (i = n - 1; i >= 0; --i) {
+        heights[i] = latencies[i];
+
+        for (j = i + 1; j < n; ++j) 
+            if (deps[i][j] && (heights[j] + latencies[i] > heights[i]))
+                heights[i] = heights[j] + latencies[i];
+    }
+
+    for (i = 0; i < n; ++i) get_insn(block, window[i]);
+
+    for (done = 0; done < n; ++done) {
+        best = -1;
+
+        for (i = 0; i < n; ++i) {
+            if (scheduled[i]) continue;
+            for (j = 0; j < i; ++j) if (deps[j][i] && !scheduled[j]) break;
+            if (j < i) continue;
+
+            start = MAX(earliest[i], cycle);
+
+            if (    (best == -1) || (start < best_start) 
+                ||  ((start == best_start) && (heights[i] > heights[best])) ) 
+            {
+                best = i;
+                best_start = start;
+            }
+        }
+
+        if (best != done) ++stats[STAT_SCHED];
+        scheduled[best] = 1;
+        put_insn(block, window[best], before);
+        cycle = best_start + 1;
+
+        for (j = best + 1; j < n; ++j) 
+            if (deps[best][j]) 
+                earliest[j] = MAX(earliest[j], best_start + latencies[best]);
+    }
+}
+
+/* schedule every block. called by optimize() after register allocation
+   with -s, and before it too with -ss. */
+
+void
+schedule(void)
+{
+    struct block * block;
+    struct insn  * insn;
+    int            n;
+
+    if (first_block->bs & B_REG)
+        analyze_blocks();
+    else
+        compute_global_defuses();
+
+    for (block = first_block; block; block = block->next) {
+        insn = block->first_insn;
+
+        while (insn) {
+            for (n = 0; insn && (n < MAX_WINDOW); ++n, insn = insn->next) 
+                window[n] = insn;
+
+            schedule_window(block, n, insn);
+        }
+    }
+}
@@ -23,6 +23,7 @@
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include <stdlib.h>
+#include <limits.h>
 #include "ncc1.h"
 
 /* switch cases are kept in a linked list */
@@ -97,9 +98,10 @@ while_statement(void)
     saved_continue_block = continue_block;
     saved_break_block = break_block;
 
+    break_block = new_block();
+    ++loop_level;
     test_block = new_block();
     body_block = new_block();
-    break_block = new_block();
     continue_block = test_block;
     succeed_block(current_block, CC_ALWAYS, test_block);
     current_block = test_block;
@@ -117,6 +119,7 @@ while_statement(void)
     statement();
     body_block = current_block;
     succeed_block(body_block, CC_ALWAYS, test_block);
+    --loop_level;
 
     current_block = break_block;
     continue_block = saved_continue_block;
@@ -134,8 +137,9 @@ do_statement(void)
 
     saved_continue_block = continue_block;
     saved_break_block = break_block;
-    continue_block = new_block();
     break_block = new_block();
+    ++loop_level;
+    continue_block = new_block();
     body_block = new_block();
     succeed_block(current_block, CC_ALWAYS, body_block);
     current_block = body_block;
@@ -144,26 +148,33 @@ do_statement(void)
     statement();
     match(KK_WHILE);
     match(KK_LPAREN);
-    test = expression();
-    test = scalar_expression(test);
     succeed_block(current_block, CC_ALWAYS, continue_block);
     current_block = continue_block;
+    test = expression();
+    test = scalar_expression(test);
     generate(test, GOAL_CC, &cc);
     match(KK_RPAREN);
     match(KK_SEMI);
     succeed_block(current_block, cc, body_block);
     succeed_block(current_block, CC_INVERT(cc), break_block);
+    --loop_level;
 
     current_block = break_block;
     continue_block = saved_continue_block;
     break_block = saved_break_block;
 }
 
+/* if every return in a function returning a struct returns the same
+   local, the optimizer can build the local in the caller's return value
+   (see nrv() [opt.c]). 'return_struct_local' tracks that local: it's 
+   NULL until the first return, and current_function once two disagree. */
+
 static void
 return_statement(void)
 {
-    struct type * return_type;
-    struct tree * tree;
+    struct type   * return_type;
+    struct tree   * tree;
+    struct symbol * local = current_function;
 
     match(KK_RETURN);
     return_type = current_function->type->next;
@@ -181,14 +192,30 @@ return_statement(void)
             tree = reg_tree(R_AX, copy_type(return_type));
 
         tree = assignment_expression(tree, ASSIGNMENT_CONST);
-        generate(tree, GOAL_EFFECT, NULL);
+
+        if (    (return_type->ts & T_TAG) && (tree->u.ch[1]->op == E_SYM) 
+            &&  (tree->u.ch[1]->u.sym->ss & S_LOCAL) && (tree->u.ch[1]->u.sym->i <= 0) )
+        {
+            local = tree->u.ch[1]->u.sym;   /* (arguments have i > 0) */
+        }
+
+        inline_return(tree);
+        generate_init(tree);
     }
 
+    if (return_struct_local == NULL) 
+        return_struct_local = local;
+    else if (return_struct_local != local)
+        return_struct_local = current_function;
+
     succeed_block(current_block, CC_ALWAYS, exit_block);
     current_block = new_block();
     match(KK_SEMI);
 }
 
+/* each clause of the for is parsed into the block in which it's evaluated,
+   since parsing an expression can generate code (e.g., call arguments). */
+
 static void
 for_statement(void)
 {
@@ -196,46 +223,53 @@ for_statement(void)
     struct block * saved_break_block;
     struct block * test_block;
     struct block * body_block;
-    struct tree *  initial = NULL;
-    struct tree *  test = NULL;
-    struct tree *  step = NULL;
+    struct tree *  tree;
     int            cc;
 
     saved_continue_block = continue_block;
     saved_break_block = break_block;
-    test_block = new_block();
-    body_block = new_block();
-    continue_block = new_block();
     break_block = new_block();
 
     lex();
     match(KK_LPAREN);
-    if (token.kk != KK_SEMI) initial = expression();
-    match(KK_SEMI);
-    if (token.kk != KK_SEMI) test = expression();
-    match(KK_SEMI);
-    if (token.kk != KK_RPAREN) step = expression();
-    match(KK_RPAREN);
 
-    if (initial) generate(initial, GOAL_EFFECT, NULL);
+    if (token.kk != KK_SEMI) {
+        tree = expression();
+        generate(tree, GOAL_EFFECT, NULL);
+    }
+
+    match(KK_SEMI);
+    ++loop_level;
+    test_block = new_block();
+    body_block = new_block();
+    continue_block = new_block();
     succeed_block(current_block, CC_ALWAYS, test_block);
     current_block = test_block;
 
-    if (test) {
-        generate(test, GOAL_CC, &cc);
+    if (token.kk != KK_SEMI) {
+        tree = expression();
+        generate(tree, GOAL_CC, &cc);
         succeed_block(current_block, cc, body_block);
         succeed_block(current_block, CC_INVERT(cc), break_block);
     } else
         succeed_block(current_block, CC_ALWAYS, body_block);
 
+    match(KK_SEMI);
+    current_block = continue_block;
+
+    if (token.kk != KK_RPAREN) {
+        tree = expression();
+        generate(tree, GOAL_EFFECT, NULL);
+    }
+
+    succeed_block(current_block, CC_ALWAYS, test_block);
+    match(KK_RPAREN);
+
     current_block = body_block;
     statement();
     succeed_block(current_block, CC_ALWAYS, continue_block);
+    --loop_level;
 
-    current_block = continue_block;
-    if (step) generate(step, GOAL_EFFECT, NULL);
-    succeed_block(current_block, CC_ALWAYS, test_block);
-    
     current_block = break_block;
     continue_block = saved_continue_block;
     break_block = saved_break_block;
@@ -246,15 +280,6 @@ compound(void)
 {
     enter_scope();
     match(KK_LBRACE);
-
-    /* if we're entering function scope and the function returns
-       a struct/union, we need to save the return-struct pointer
-       (which is passed by the caller in RAX) in the temporary
-       allocated for that purpose before doing anything else. */
-
-    if ((current_scope == SCOPE_FUNCTION) && return_struct_temp) 
-        choose(E_ASSIGN, copy_tree(return_struct_temp), reg_tree(R_AX, new_type(T_LONG)));
-
     local_declarations();
     while (token.kk != KK_RBRACE) statement();
     match(KK_RBRACE);
@@ -304,6 +329,154 @@ goto_statement(void)
     current_block = new_block();
 }
 
+/* once the body of the switch is parsed, the cases are sorted and the
+   dispatch is built recursively: a few cases get a chain of compares,
+   dense ranges get a jump table, and anything else is split in two by
+   binary search. the value being switched on is in RAX throughout. */
+
+#define SWITCH_LINEAR       4       /* no more cases than this: compare each */
+#define SWITCH_DENSITY      3       /* table if the range is no more than */
+                                    /* this many times the number of cases */
+#define SWITCH_TABLE_MAX    4096    /* .. and no more than this */
+
+static int
+case_cmp(const void * v1, const void * v2)
+{
+    const struct switchcase * c1 = *(const struct switchcase **) v1;
+    const struct switchcase * c2 = *(const struct switchcase **) v2;
+
+    if (switch_type->ts & T_IS_UNSIGNED) 
+        return ((unsigned long) c1->value->u.con.i > (unsigned long) c2->value->u.con.i)
+             - ((unsigned long) c1->value->u.con.i < (unsigned long) c2->value->u.con.i);
+    else
+        return (c1->value->u.con.i > c2->value->u.con.i) - (c1->value->u.con.i < c2->value->u.con.i);
+}
+
+/* compare RAX with a case value. quadword comparisons can only take
+   32-bit (sign-extended) immediates, so larger values are loaded. */
+
+static void
+compare(struct tree * reg_ax, struct tree * value)
+{
+    struct tree * temp;
+
+    value = copy_tree(value);
+
+    if ((value->type->ts & T_IS_QWORD) && ((value->u.con.i < INT_MIN) || (value->u.con.i > INT_MAX))) {
+        temp = temporary(copy_type(value->type));
+        put_insn(current_block, new_insn(I_MOV, copy_tree(temp), value), NULL);
+        value = temp;
+    }
+
+    put_insn(current_block, new_insn(I_CMP, copy_tree(reg_ax), value), NULL);
+}
+
+/* the table covers the range from the first case to the last, and holes
+   are filled with the default. values out of range are weeded out with 
+   one unsigned compare after rebasing RAX at zero. */
+
+static void
+jump_table(struct switchcase ** cases, int nr_cases, struct tree * reg_ax)
+{
+    struct symbol * table;
+    struct tree   * index;
+    struct tree   * base;
+    struct tree   * entry;
+    long            lo;
+    long            range;
+    int             ts;
+    int             i;
+    int             j;
+
+    ts = switch_type->ts & T_BASE;
+    lo = cases[0]->value->u.con.i;
+    range = cases[nr_cases - 1]->value->u.con.i - lo + 1;
+
+    /* the index is all of RAX, so bytes and words are first extended to
+       a dword (whose operations clear the upper half of the register). */
+
+    if (ts & (T_IS_BYTE | T_IS_WORD)) {
+        index = reg_tree(R_AX, new_type(T_INT));
+        put_insn(current_block, new_insn((ts & T_IS_UNSIGNED) ? I_MOVZX : I_MOVSX, 
+                                         copy_tree(index), copy_tree(reg_ax)), NULL);
+        ts = T_INT;
+    } else
+        index = copy_tree(reg_ax);
+
+    if (lo) put_insn(current_block, new_insn(I_SUB, copy_tree(index), int_tree(ts, lo)), NULL);
+    put_insn(current_block, new_insn(I_CMP, index, int_tree(ts, range - 1)), NULL);
+    succeed_block(current_block, CC_A, default_block);
+    succeed_block(current_block, CC_BE, new_block());
+    current_block = block_successor(current_block, 0);
+
+    table = new_symbol(NULL, S_STATIC, new_type(T_LONG));
+    table->i = next_asm_label++;
+    put_symbol(table, SCOPE_RETIRED);
+    current_block->table = table;
+
+    base = temporary(new_type(T_LONG));
+    put_insn(current_block, new_insn(I_LEA, copy_tree(base), memory_tree(table)), NULL);
+    entry = new_tree(E_MEM, new_type(T_LONG));
+    entry->u.mi.b = base->u.reg;
+    entry->u.mi.i = R_AX;
+    entry->u.mi.s = 8;
+    put_insn(current_block, new_insn(I_JMP, entry), NULL);
+    free_tree(base);
+
+    for (i = 0, j = 0; i < range; ++i) {
+        if (cases[j]->value->u.con.i == lo + i)
+            succeed_block(current_block, CC_TABLE + i, cases[j++]->target);
+        else
+            succeed_block(current_block, CC_TABLE + i, default_block);
+    }
+}
+
+static void
+dispatch(struct switchcase ** cases, int nr_cases, struct tree * reg_ax)
+{
+    struct block * left;
+    struct block * right;
+    unsigned long  range;
+    int            half;
+    int            i;
+
+    if (nr_cases <= SWITCH_LINEAR) {
+        for (i = 0; i < nr_cases; ++i) {
+            compare(reg_ax, cases[i]->value);
+            succeed_block(current_block, CC_Z, cases[i]->target);
+            succeed_block(current_block, CC_NZ, new_block());
+            current_block = block_successor(current_block, 0);
+        }
+
+        succeed_block(current_block, CC_ALWAYS, default_block);
+        return;
+    }
+
+    /* a quadword range must start at a value usable as an immediate. */
+
+    range = cases[nr_cases - 1]->value->u.con.i - cases[0]->value->u.con.i;
+
+    if (    (range < SWITCH_TABLE_MAX) 
+        &&  (range < (unsigned long) nr_cases * SWITCH_DENSITY)
+        &&  (!(switch_type->ts & T_IS_QWORD) || ((cases[0]->value->u.con.i >= INT_MIN) 
+                                              && (cases[0]->value->u.con.i <= INT_MAX))))
+    {
+        jump_table(cases, nr_cases, reg_ax);
+        return;
+    }
+
+    half = nr_cases / 2;
+    compare(reg_ax, cases[half - 1]->value);
+    left = new_block();
+    right = new_block();
+    succeed_block(current_block, (switch_type->ts & T_IS_UNSIGNED) ? CC_A : CC_G, right);
+    succeed_block(current_block, (switch_type->ts & T_IS_UNSIGNED) ? CC_BE : CC_LE, left);
+    current_block = left;
+    dispatch(cases, half, reg_ax);
+    current_block = right;
+    dispatch(cases + half, nr_cases - half, reg_ax);
+}
+
 static void
 switch_statement(void)
 {
@@ -314,6 +487,10 @@ switch_statement(void)
     struct tree       * tree;
     struct tree       * reg_ax;
     struct block      * control_block;
+    struct switchcase * switchcase;
+    struct switchcase** cases;
+    int                 nr_cases;
+    int                 i;
 
     saved_switchcases = switchcases;
     saved_default_block = default_block;
@@ -341,23 +518,24 @@ switch_statement(void)
 
     current_block = control_block;
 
-    while (switchcases) {
-        struct switchcase * switchcase;
-        struct block      * tmp;
+    for (nr_cases = 0, switchcase = switchcases; switchcase; switchcase = switchcase->next)
+        ++nr_cases;
 
-        switchcase = switchcases;
-        switchcases = switchcases->next;
+    cases = allocate(sizeof(struct switchcase *) * (nr_cases + 1));
 
-        put_insn(current_block, new_insn(I_CMP, copy_tree(reg_ax), switchcase->value), NULL);
-        succeed_block(current_block, CC_Z, switchcase->target);
-        succeed_block(current_block, CC_NZ, tmp = new_block());
-        current_block = tmp;
+    for (i = 0, switchcase = switchcases; switchcase; switchcase = switchcase->next) 
+        cases[i++] = switchcase;
 
+    qsort(cases, nr_cases, sizeof(struct switchcase *), case_cmp);
+    dispatch(cases, nr_cases, reg_ax);
+
+    while (switchcase = switchcases) {
+        switchcases = switchcase->next;
+        free_tree(switchcase->value);
         free(switchcase);
     }
 
-    succeed_block(current_block, CC_ALWAYS, default_block);
-
+    free(cases);
     free_tree(reg_ax);
     current_block = break_block;
     switchcases = saved_switchcases;
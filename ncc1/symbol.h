@@ -116,6 +116,12 @@ struct string
 
 #define S_HIDDEN        0x08000000
 
+    /* S_NEEDED is set on a function once its address is used in 
+       generated code. inline.c uses it to decide whether to output 
+       an out-of-line copy of a function that has been inlined. */
+
+#define S_NEEDED        0x04000000
+
     /* file-scope variable definitions that aren't explicitly
        initialized are S_TENTATIVE; if we get to the end of 
        the translation unit without an actual definition for
@@ -162,6 +162,39 @@ copy_tree(struct tree * tree)
     return tree2;
 }
 
+/* are the leaves 't1' and 't2' the same operand? (E_REG, E_CON, E_MEM or 
+   E_IMM only; anything else is never considered the same.) */
+
+int
+same_tree(struct tree * t1, struct tree * t2)
+{
+    if (t1->op != t2->op) return 0;
+    if (t1->type->ts != t2->type->ts) return 0;
+
+    switch (t1->op) 
+    {
+    case E_REG:
+        return (t1->u.reg == t2->u.reg);
+
+    case E_CON:
+        if (t1->type->ts & T_IS_FLOAT)
+            return (memcmp(&t1->u.con.f, &t2->u.con.f, sizeof(t1->u.con.f)) == 0);
+        else
+            return (t1->u.con.i == t2->u.con.i);
+
+    case E_MEM:
+    case E_IMM:
+        return (    (t1->u.mi.glob == t2->u.mi.glob) 
+                &&  (t1->u.mi.ofs == t2->u.mi.ofs)
+                &&  (t1->u.mi.b == t2->u.mi.b)
+                &&  (t1->u.mi.i == t2->u.mi.i)
+                &&  ((t1->u.mi.i == R_NONE) || (t1->u.mi.s == t2->u.mi.s))
+                &&  (t1->u.mi.rip == t2->u.mi.rip)  );
+    }
+
+    return 0;
+}
+
 /* create an E_SYM node that references 'symbol'. must be
    used rather than creating the node manually to be sure 
    we catch all referenced S_EXTERNs. */
@@ -209,6 +242,7 @@ memory_tree(struct symbol * symbol)
     } else {
         tree->u.mi.glob = symbol;
         tree->u.mi.rip = 1;
+        if (symbol->type->ts & T_FUNC) symbol->ss |= S_NEEDED;
     } 
 
     return tree;
@@ -251,14 +285,27 @@ stack_tree(struct type * type, int offset)
     return tree;
 }
 
-/* take the address of the tree. obviously must be an lvalue. */
+/* take the address of the tree. obviously must be an lvalue. 
+
+   member_expression() builds s.m as *(&s + m) without calling this, 
+   since that use of the address of 's' goes no further. taking the
+   address of 's.m' (or of 's.m.n'...) is another matter, so the 
+   chain is followed back to 's' to make sure it's marked here. */
 
 struct tree *
 addr_tree(struct tree * tree)
 {
-    if ((tree->op == E_SYM) && (tree->u.sym->ss & S_LOCAL)) {
-        tree->u.sym->ss &= ~S_LOCAL;
-        tree->u.sym->ss |= S_AUTO;
+    struct tree * root = tree;
+
+    while (     (root->op == E_FETCH) && (root->u.ch[0]->op == E_ADD) 
+            &&  (root->u.ch[0]->u.ch[0]->op == E_ADDR) )
+    {
+        root = root->u.ch[0]->u.ch[0]->u.ch[0];
+    }
+
+    if ((root->op == E_SYM) && (root->u.sym->ss & S_LOCAL)) {
+        root->u.sym->ss &= ~S_LOCAL;
+        root->u.sym->ss |= S_AUTO;
     }
 
     return new_tree(E_ADDR, splice_types(new_type(T_PTR), copy_type(tree->type)), tree);
@@ -718,7 +765,7 @@ member_expression(struct tree * tree)
 
     if (token.kk == KK_DOT) {
         lvalue(tree);
-        tree = addr_tree(tree);
+        tree = new_tree(E_ADDR, splice_types(new_type(T_PTR), copy_type(tree->type)), tree);
     }
 
     if (!(tree->type->ts & T_PTR)) error(ERROR_INDIR);